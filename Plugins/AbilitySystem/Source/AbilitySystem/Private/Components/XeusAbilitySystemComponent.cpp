@@ -3,30 +3,138 @@
 
 #include "Components//XeusAbilitySystemComponent.h"
 
+#include "AbilitySystem.h"
+#include "Data/XeusAttributeSetDefinition.h"
+#include "Data/XeusEffectBundle.h"
+#include "Data/XeusEffectSpec.h"
+#include "Data/Attributes/XeusDerivedAttribute.h"
+#include "Data/XeusAbilitySystemViewModel.h"
+#include "Subsystems/XeusAbilityQuerySubsystem.h"
+#include "Subsystems/XeusAbilitySaveSubsystem.h"
+#include "Subsystems/XeusAreaEffectSubsystem.h"
+#include "Subsystems/XeusEffectIconSubsystem.h"
+
 #include "Engine/ActorChannel.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/Texture2D.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/ThreadSafeCounter.h"
 #include "Net/UnrealNetwork.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/UObjectIterator.h"
+
+/**
+ * Archive that only calculates CRC of saved data
+ * Names are hashed by their string, so hash is the same in every process
+ */
+class FXeusStateHashArchive : public FArchive
+{
+public:
+	uint32 Crc = 0;
+
+	FXeusStateHashArchive()
+	{
+		SetIsSaving(true);
+	}
+
+	virtual void Serialize(void* Data, int64 Num) override
+	{
+		Crc = FCrc::MemCrc32(Data, Num, Crc);
+	}
+
+	virtual FArchive& operator<<(FName& Value) override
+	{
+		FString name = Value.ToString();
+		return *this << name;
+	}
+
+	virtual FString GetArchiveName() const override
+	{
+		return TEXT("FXeusStateHashArchive");
+	}
+};
 
 UXeusAbilitySystemComponent::UXeusAbilitySystemComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
 	SetIsReplicatedByDefault(true);
 	InitialAttributes = {};
+	AttributeSet = nullptr;
 	Effects = {};
 	Attributes = {};
+	bHasDirtyDerived = false;
+	ViewModel = nullptr;
+	QuerySubsystem = nullptr;
+	bPrefetchIcons = true;
+	IconSubsystem = nullptr;
+	bAttributesInitialized = false;
+	EffectTime = 0.0;
+	bEffectsPaused = false;
+	EffectTimeScale = 1.0f;
+	LastEffectTimerId = 0;
+	bDeterministic = false;
+	FixedStep = 1.0f / 60.0f;
+	bAutoStep = true;
+	bHashSteps = true;
+	StepIndex = 0;
+	StepAccumulator = 0.0;
+	StepStateHash = 0;
+	HistoryLength = 0;
+	RollbackFrameCount = 0;
+	bRollbackBaseline = false;
+	bResimulating = false;
+	LastEffectSerial = 0;
+	StateRevision = 1;
+	FMemory::Memzero(RejectCounts);
+
+	// Components can be constructed by async loading, zero is owner of invalid handle
+	static FThreadSafeCounter lastHandleOwner;
+	EffectHandleOwner = lastHandleOwner.Increment();
 }
 
 void UXeusAbilitySystemComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	for (const auto& effectClass : InitialImmunities)
+		AddEffectImmunity(effectClass);
+	for (const FGameplayTag& tag : InitialImmunityTags)
+		AddImmunityTag(tag);
+
 	InitAttributes();
 	InitEffects();
+	RequestInitialClasses();
+
+	UWorld* world = GetWorld();
+	if (!world)
+		return;
+
+	// Restores loaded state of component if there is one
+	if (UXeusAbilitySaveSubsystem* saveSubsystem = world->GetSubsystem<UXeusAbilitySaveSubsystem>())
+		saveSubsystem->RegisterComponent(this);
+
+	QuerySubsystem = world->GetSubsystem<UXeusAbilityQuerySubsystem>();
+	if (QuerySubsystem)
+		QuerySubsystem->RegisterComponent(this);
 }
 
 void UXeusAbilitySystemComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
+	UWorld* world = GetWorld();
+	if (UXeusAbilitySaveSubsystem* saveSubsystem = world ? world->GetSubsystem<UXeusAbilitySaveSubsystem>() : nullptr)
+		saveSubsystem->UnregisterComponent(this);
+	if (QuerySubsystem)
+	{
+		QuerySubsystem->UnregisterComponent(this);
+		QuerySubsystem = nullptr;
+	}
+
+	CancelStreaming();
 	RemoveAllAttributes();
 	RemoveAllEffects();
 }
@@ -44,6 +152,19 @@ void UXeusAbilitySystemComponent::InitEffects()
 
 void UXeusAbilitySystemComponent::InitAttributes()
 {
+	if (AttributeSet)
+	{
+		const TArray<const FXeusAttributeDefinition*>& definitions = AttributeSet->GetDefinitions();
+		Attributes.Reserve(Attributes.Num() + definitions.Num() + InitialAttributes.Num());
+		for (const FXeusAttributeDefinition* definition : definitions)
+		{
+			if (definition->AttributeClass)
+			{
+				AddAttributeImpl(definition->AttributeClass);
+			}
+		}
+	}
+
 	for (const auto& attributeClass : InitialAttributes)
 	{
 		if (attributeClass)
@@ -51,104 +172,1682 @@ void UXeusAbilitySystemComponent::InitAttributes()
 			AddAttributeImpl(attributeClass);
 		}
 	}
+
+	bAttributesInitialized = true;
+	RebuildDependencyGraph();
+	FlushDerivedAttributes();
+}
+
+void UXeusAbilitySystemComponent::RequestInitialClasses()
+{
+	TArray<FSoftObjectPath> paths;
+	for (const auto& attributeClass : SoftInitialAttributes)
+		if (attributeClass.IsPending())
+			paths.Add(attributeClass.ToSoftObjectPath());
+	for (const auto& effectClass : SoftInitialEffects)
+		if (effectClass.IsPending())
+			paths.Add(effectClass.ToSoftObjectPath());
+
+	if (paths.Num() == 0)
+	{
+		OnInitialClassesLoaded();
+		return;
+	}
+
+	InitialClassesHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		paths, FStreamableDelegate::CreateUObject(this, &UXeusAbilitySystemComponent::OnInitialClassesLoaded));
+}
+
+void UXeusAbilitySystemComponent::OnInitialClassesLoaded()
+{
+	InitialClassesHandle.Reset();
+
+	for (const auto& attributeClass : SoftInitialAttributes)
+	{
+		if (UClass* loaded = attributeClass.Get())
+		{
+			AddAttributeImpl(loaded);
+		}
+	}
+
+	for (const auto& effectClass : SoftInitialEffects)
+	{
+		if (UClass* loaded = effectClass.Get())
+		{
+			AddEffectImpl(loaded);
+		}
+	}
+}
+
+void UXeusAbilitySystemComponent::CancelStreaming()
+{
+	if (InitialClassesHandle.IsValid())
+	{
+		InitialClassesHandle->CancelHandle();
+		InitialClassesHandle.Reset();
+	}
+
+	if (SnapshotClassesHandle.IsValid())
+	{
+		SnapshotClassesHandle->CancelHandle();
+		SnapshotClassesHandle.Reset();
+	}
+
+	for (const auto& handle : PendingEffectLoads)
+		handle->CancelHandle();
+	PendingEffectLoads.Empty();
+
+	for (const auto& pair : BundleStreaming)
+	{
+		if (pair.Value.ClassesHandle.IsValid())
+			pair.Value.ClassesHandle->ReleaseHandle();
+		if (pair.Value.IconsHandle.IsValid())
+			pair.Value.IconsHandle->ReleaseHandle();
+	}
+	BundleStreaming.Empty();
+
+	ReleaseAllIcons();
+}
+
+void UXeusAbilitySystemComponent::TickComponent(float DeltaTime, ELevelTick TickType,
+                                                FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (bDeterministic)
+	{
+		if (bAutoStep && !bEffectsPaused)
+		{
+			StepAccumulator += static_cast<double>(DeltaTime) * EffectTimeScale;
+			const int32 steps = FMath::FloorToInt(static_cast<float>(StepAccumulator / FixedStep));
+			StepAccumulator -= steps * static_cast<double>(FixedStep);
+			AdvanceFixedStep(steps);
+		}
+	}
+	else if (!bEffectsPaused)
+	{
+		AdvanceEffectTime(static_cast<double>(DeltaTime) * EffectTimeScale);
+	}
+
+	FlushDerivedAttributes();
+}
+
+void UXeusAbilitySystemComponent::AdvanceEffectTime(double DeltaTime)
+{
+	EffectTime += DeltaTime;
+	// Clock alone does not make snapshot of idle component outdated
+	if (Effects.Num() > 0 || EffectTimers.Num() > 0)
+		++StateRevision;
+
+	while (EffectTimerQueue.Num() > 0 && EffectTimerQueue.HeapTop().FireTime <= EffectTime)
+	{
+		FXeusEffectTimerEntry entry;
+		EffectTimerQueue.HeapPop(entry, false);
+
+		FXeusEffectTimer* timer = EffectTimers.Find(entry.Id);
+		if (!timer || timer->bPaused || timer->Version != entry.Version)
+			continue;
+
+		// Copy callback, timer can be cleared or map reallocated inside of it
+		const FSimpleDelegate callback = timer->Callback;
+		if (timer->bLoop)
+		{
+			timer->FireTime = entry.FireTime + timer->Rate;
+			QueueEffectTimer(entry.Id, *timer);
+		}
+		else
+		{
+			EffectTimers.Remove(entry.Id);
+		}
+
+		callback.ExecuteIfBound();
+	}
+}
+
+void UXeusAbilitySystemComponent::AdvanceFixedStep(int32 Steps)
+{
+	if (!bDeterministic)
+		return;
+
+	for (int32 i = 0; i < Steps; ++i)
+		SimulateStep();
+}
+
+void UXeusAbilitySystemComponent::SimulateStep()
+{
+	// Changes made between steps (applied inputs) belong to the next step
+	if (HistoryLength > 0 && !bRollbackBaseline)
+		CaptureRollbackBaseline();
+
+	const double previousTime = EffectTime;
+	++StepIndex;
+	// Pause stops effect clock, but steps are still counted to stay in lockstep
+	if (!bEffectsPaused)
+		AdvanceEffectTime(FixedStep);
+	FlushDerivedAttributes();
+
+	if (HistoryLength > 0)
+		RecordRollbackFrame(previousTime);
+
+	StepStateHash = bHashSteps ? CalculateStateHash() : 0;
+	OnSimulationStep.Broadcast(this, StepIndex, static_cast<int32>(StepStateHash));
+}
+
+uint32 UXeusAbilitySystemComponent::CalculateStateHash()
+{
+	FXeusStateHashArchive ar;
+	ar << StepIndex;
+	ar << EffectTime;
+
+	for (UXeusAttribute* attribute : Attributes)
+	{
+		if (!attribute)
+			continue;
+		FString className = attribute->GetClass()->GetName();
+		ar << className;
+		attribute->SerializeState(ar);
+	}
+
+	for (UXeusEffect* effect : Effects)
+	{
+		if (!effect)
+			continue;
+		FString className = effect->GetClass()->GetName();
+		ar << className;
+		effect->SerializeState(ar);
+	}
+
+	return ar.Crc;
+}
+
+/**
+ * @brief Save sources of effect stacks, context and settings, they are not part of serialized state
+ */
+static void SaveRollbackSources(const UXeusEffect* Effect, FXeusRollbackObjectState& OutState)
+{
+	OutState.Context = Effect->GetContext();
+	OutState.InstigatorKey = Effect->GetInstigatorKey();
+	OutState.Settings = Effect->GetAppliedSettings();
+	const int32 count = Effect->GetStackCount();
+	OutState.StackSources.SetNum(count);
+	for (int32 i = 0; i < count; ++i)
+		OutState.StackSources[i] = Effect->GetStack(i).Source;
+}
+
+/**
+ * @brief Apply saved sources to stacks of restored effect and its applied settings
+ */
+static void LoadRollbackSources(UXeusEffect* Effect, const FXeusRollbackObjectState& State)
+{
+	Effect->RestoreAppliedSettings(State.Settings);
+	const int32 count = FMath::Min(Effect->GetStackCount(), State.StackSources.Num());
+	for (int32 i = 0; i < count; ++i)
+		Effect->SetStackSource(i, State.StackSources[i].Get());
+}
+
+void UXeusAbilitySystemComponent::CaptureRollbackBaseline()
+{
+	RollbackAttributeStates.Reset();
+	RollbackEffectStates.Reset();
+
+	for (int32 i = 0; i < Attributes.Num(); ++i)
+	{
+		UXeusAttribute* attribute = Attributes[i];
+		if (!attribute)
+			continue;
+		FXeusRollbackObjectState& state = RollbackAttributeStates.Add(attribute->GetClass());
+		state.Class = attribute->GetClass();
+		state.Order = i;
+		FMemoryWriter writer(state.State);
+		attribute->SerializeState(writer);
+	}
+
+	for (int32 i = 0; i < Effects.Num(); ++i)
+	{
+		UXeusEffect* effect = Effects[i];
+		if (!effect)
+			continue;
+		FXeusRollbackObjectState& state = RollbackEffectStates.Add(effect->GetRollbackSerial());
+		state.Serial = effect->GetRollbackSerial();
+		state.Class = effect->GetClass();
+		state.Order = i;
+		FMemoryWriter writer(state.State);
+		effect->SerializeState(writer);
+		SaveRollbackSources(effect, state);
+	}
+
+	RollbackFrames.SetNum(HistoryLength);
+	RollbackFrameCount = 0;
+	bRollbackBaseline = true;
+}
+
+void UXeusAbilitySystemComponent::RecordRollbackFrame(double PreviousEffectTime)
+{
+	FXeusRollbackFrame& frame = RollbackFrames[StepIndex % HistoryLength];
+	frame.Step = StepIndex;
+	frame.EffectTime = PreviousEffectTime;
+	frame.ChangedAttributes.Reset();
+	frame.RemovedAttributes.Reset();
+	frame.AddedAttributes.Reset();
+	frame.ChangedEffects.Reset();
+	frame.RemovedEffects.Reset();
+	frame.AddedEffects.Reset();
+	RollbackFrameCount = FMath::Min(RollbackFrameCount + 1, HistoryLength);
+
+	TArray<uint8> state;
+	TSet<UClass*> aliveAttributes;
+	aliveAttributes.Reserve(Attributes.Num());
+	for (int32 i = 0; i < Attributes.Num(); ++i)
+	{
+		UXeusAttribute* attribute = Attributes[i];
+		if (!attribute)
+			continue;
+		UClass* attributeClass = attribute->GetClass();
+		aliveAttributes.Add(attributeClass);
+
+		state.Reset();
+		FMemoryWriter writer(state);
+		attribute->SerializeState(writer);
+
+		FXeusRollbackObjectState* previous = RollbackAttributeStates.Find(attributeClass);
+		if (!previous)
+		{
+			frame.AddedAttributes.Add(attributeClass);
+			previous = &RollbackAttributeStates.Add(attributeClass);
+			previous->Class = attributeClass;
+		}
+		else if (previous->State != state)
+		{
+			frame.ChangedAttributes.Add(*previous);
+		}
+		previous->Order = i;
+		previous->State = state;
+	}
+
+	for (auto it = RollbackAttributeStates.CreateIterator(); it; ++it)
+	{
+		if (!aliveAttributes.Contains(it.Key()))
+		{
+			frame.RemovedAttributes.Add(MoveTemp(it.Value()));
+			it.RemoveCurrent();
+		}
+	}
+	// Undo inserts removed attributes back by index, lower indices first
+	frame.RemovedAttributes.Sort([](const FXeusRollbackObjectState& A, const FXeusRollbackObjectState& B)
+	{
+		return A.Order < B.Order;
+	});
+
+	TSet<uint32> alive;
+	alive.Reserve(Effects.Num());
+	for (int32 i = 0; i < Effects.Num(); ++i)
+	{
+		UXeusEffect* effect = Effects[i];
+		if (!effect)
+			continue;
+		const uint32 serial = effect->GetRollbackSerial();
+		alive.Add(serial);
+
+		state.Reset();
+		FMemoryWriter writer(state);
+		effect->SerializeState(writer);
+
+		FXeusRollbackObjectState* previous = RollbackEffectStates.Find(serial);
+		if (!previous)
+		{
+			frame.AddedEffects.Add(serial);
+			previous = &RollbackEffectStates.Add(serial);
+			previous->Serial = serial;
+			previous->Class = effect->GetClass();
+		}
+		else if (previous->State != state || previous->Order != i)
+		{
+			frame.ChangedEffects.Add(*previous);
+		}
+		previous->Order = i;
+		previous->State = state;
+		SaveRollbackSources(effect, *previous);
+	}
+
+	for (auto it = RollbackEffectStates.CreateIterator(); it; ++it)
+	{
+		if (!alive.Contains(it.Key()))
+		{
+			frame.RemovedEffects.Add(MoveTemp(it.Value()));
+			it.RemoveCurrent();
+		}
+	}
+}
+
+void UXeusAbilitySystemComponent::UndoRollbackFrame(const FXeusRollbackFrame& Frame)
+{
+	// Attributes first, restored effects are linked to them
+	for (UClass* attributeClass : Frame.AddedAttributes)
+	{
+		RemoveAttribute(attributeClass);
+		RollbackAttributeStates.Remove(attributeClass);
+	}
+
+	for (const FXeusRollbackObjectState& removed : Frame.RemovedAttributes)
+	{
+		UXeusAttribute* attribute = AddAttributeImpl(removed.Class);
+		if (!attribute)
+			continue;
+		FMemoryReader reader(removed.State);
+		attribute->SerializeState(reader);
+		// Attribute is added at the end, return it to its index
+		const int32 index = Attributes.Find(attribute);
+		const int32 order = FMath::Clamp(removed.Order, 0, Attributes.Num() - 1);
+		if (index != order)
+		{
+			Attributes.RemoveAt(index);
+			Attributes.Insert(attribute, order);
+		}
+		RollbackAttributeStates.Add(removed.Class, removed);
+	}
+
+	for (const uint32 serial : Frame.AddedEffects)
+	{
+		UXeusEffect* const* found = Effects.FindByPredicate([serial](const UXeusEffect* Effect)
+		{
+			return Effect && Effect->GetRollbackSerial() == serial;
+		});
+		if (found)
+			UnlinkEffect(*found);
+		RollbackEffectStates.Remove(serial);
+	}
+
+	for (const FXeusRollbackObjectState& removed : Frame.RemovedEffects)
+	{
+		UXeusEffect* effect = NewEffectInstance(removed.Class);
+		effect->SetRollbackSerial(removed.Serial);
+		// Context is set before link, so effect is indexed by its instigator again
+		effect->RestoreContext(removed.Context, removed.InstigatorKey);
+		effect->InitStacks(nullptr, static_cast<float>(GetEffectTime()));
+		FMemoryReader reader(removed.State);
+		effect->SerializeState(reader);
+		LoadRollbackSources(effect, removed);
+		LinkEffect(effect);
+		RollbackEffectStates.Add(removed.Serial, removed);
+	}
+
+	for (const FXeusRollbackObjectState& changed : Frame.ChangedEffects)
+	{
+		UXeusEffect* const* found = Effects.FindByPredicate([&changed](const UXeusEffect* Effect)
+		{
+			return Effect && Effect->GetRollbackSerial() == changed.Serial;
+		});
+		if (found)
+		{
+			FMemoryReader reader(changed.State);
+			(*found)->SerializeState(reader);
+			LoadRollbackSources(*found, changed);
+		}
+		RollbackEffectStates.Add(changed.Serial, changed);
+	}
+
+	for (const FXeusRollbackObjectState& changed : Frame.ChangedAttributes)
+	{
+		UXeusAttribute* attribute = GetAttributeByClass(changed.Class);
+		if (!attribute)
+			continue;
+		FMemoryReader reader(changed.State);
+		attribute->SerializeState(reader);
+		RollbackAttributeStates.Add(changed.Class, changed);
+	}
+
+	EffectTime = Frame.EffectTime;
+	StepIndex = Frame.Step - 1;
+}
+
+bool UXeusAbilitySystemComponent::RewindTo(int32 Step)
+{
+	if (!bRollbackBaseline || Step > StepIndex || Step < StepIndex - RollbackFrameCount)
+		return false;
+
+	while (StepIndex > Step)
+	{
+		UndoRollbackFrame(RollbackFrames[StepIndex % HistoryLength]);
+		--RollbackFrameCount;
+	}
+
+	// Restore order of effects as it was after step
+	Effects.Sort([this](const UXeusEffect& A, const UXeusEffect& B)
+	{
+		const FXeusRollbackObjectState* stateA = RollbackEffectStates.Find(A.GetRollbackSerial());
+		const FXeusRollbackObjectState* stateB = RollbackEffectStates.Find(B.GetRollbackSerial());
+		return (stateA ? stateA->Order : MAX_int32) < (stateB ? stateB->Order : MAX_int32);
+	});
+
+	// Timers and aggregates are rebuilt from restored state
+	EffectTimers.Empty();
+	EffectTimerQueue.Empty();
+	ModifierAggregates.Empty();
+	for (UXeusEffect* effect : Effects)
+		RegisterEffectModifiers(effect);
+	for (UXeusEffect* effect : Effects)
+		effect->NotifyRestored(this);
+
+	for (UXeusAttribute* attribute : Attributes)
+		MarkDependentsDirty(attribute);
+	FlushDerivedAttributes();
+
+	StepAccumulator = 0.0;
+	StepStateHash = bHashSteps ? CalculateStateHash() : 0;
+	if (QuerySubsystem)
+		QuerySubsystem->RefreshComponent(this);
+	MarkStateChanged();
+	OnStateReset.Broadcast(this);
+	OnRewound.Broadcast(this, StepIndex, static_cast<int32>(StepStateHash));
+	return true;
+}
+
+void UXeusAbilitySystemComponent::ResimulateTo(int32 Step)
+{
+	if (!bDeterministic)
+		return;
+
+	bResimulating = true;
+	while (StepIndex < Step)
+		SimulateStep();
+	bResimulating = false;
+}
+
+int32 UXeusAbilitySystemComponent::GetRollbackDepth() const
+{
+	return RollbackFrameCount;
+}
+
+bool UXeusAbilitySystemComponent::IsResimulating() const
+{
+	return bResimulating;
+}
+
+void UXeusAbilitySystemComponent::ResetRollbackHistory()
+{
+	RollbackFrames.Reset();
+	RollbackFrameCount = 0;
+	RollbackAttributeStates.Reset();
+	RollbackEffectStates.Reset();
+	bRollbackBaseline = false;
+}
+
+bool UXeusAbilitySystemComponent::IsDeterministic() const
+{
+	return bDeterministic;
+}
+
+void UXeusAbilitySystemComponent::SetDeterministic(bool bInDeterministic, int32 InHistoryLength, bool bInAutoStep)
+{
+	bDeterministic = bInDeterministic;
+	HistoryLength = FMath::Max(InHistoryLength, 0);
+	bAutoStep = bInAutoStep;
+	StepAccumulator = 0.0;
+	ResetRollbackHistory();
+}
+
+int32 UXeusAbilitySystemComponent::GetStepIndex() const
+{
+	return StepIndex;
+}
+
+int32 UXeusAbilitySystemComponent::GetStateHash() const
+{
+	return static_cast<int32>(StepStateHash);
+}
+
+void UXeusAbilitySystemComponent::QueueEffectTimer(uint64 Id, FXeusEffectTimer& Timer)
+{
+	++Timer.Version;
+	EffectTimerQueue.HeapPush({Timer.FireTime, Id, Timer.Version});
+}
+
+void UXeusAbilitySystemComponent::PauseAllEffects()
+{
+	if (bEffectsPaused)
+		return;
+	bEffectsPaused = true;
+	MarkStateChanged();
+	OnEffectsPaused.Broadcast(this);
+}
+
+void UXeusAbilitySystemComponent::ResumeAllEffects()
+{
+	if (!bEffectsPaused)
+		return;
+	bEffectsPaused = false;
+	MarkStateChanged();
+	OnEffectsResumed.Broadcast(this);
+}
+
+bool UXeusAbilitySystemComponent::AreEffectsPaused() const
+{
+	return bEffectsPaused;
+}
+
+void UXeusAbilitySystemComponent::SetEffectTimeScale(float Value)
+{
+	EffectTimeScale = FMath::Max(Value, 0.0f);
+	MarkStateChanged();
+}
+
+float UXeusAbilitySystemComponent::GetEffectTimeScale() const
+{
+	return EffectTimeScale;
+}
+
+float UXeusAbilitySystemComponent::BP_GetEffectTime() const
+{
+	return static_cast<float>(EffectTime);
+}
+
+double UXeusAbilitySystemComponent::GetEffectTime() const
+{
+	return EffectTime;
+}
+
+FXeusEffectTimerHandle UXeusAbilitySystemComponent::SetEffectTimer(FSimpleDelegate Callback, float Delay, bool bLoop,
+                                                                   float Rate)
+{
+	FXeusEffectTimer timer;
+	timer.Callback = MoveTemp(Callback);
+	timer.bLoop = bLoop;
+	// Looping timer must move forward, otherwise queue never drains
+	timer.Rate = FMath::Max(Rate > 0.0f ? Rate : Delay, KINDA_SMALL_NUMBER);
+	timer.FireTime = EffectTime + FMath::Max(Delay, 0.0f);
+
+	FXeusEffectTimerHandle handle;
+	handle.Id = ++LastEffectTimerId;
+	QueueEffectTimer(handle.Id, EffectTimers.Add(handle.Id, MoveTemp(timer)));
+	return handle;
+}
+
+void UXeusAbilitySystemComponent::ClearEffectTimer(FXeusEffectTimerHandle& Handle)
+{
+	// Queue entry becomes outdated and is skipped
+	EffectTimers.Remove(Handle.Id);
+	Handle.Invalidate();
+}
+
+void UXeusAbilitySystemComponent::PauseEffectTimer(FXeusEffectTimerHandle Handle)
+{
+	FXeusEffectTimer* timer = EffectTimers.Find(Handle.Id);
+	if (!timer || timer->bPaused)
+		return;
+
+	timer->bPaused = true;
+	timer->Remaining = FMath::Max(timer->FireTime - EffectTime, 0.0);
+}
+
+void UXeusAbilitySystemComponent::UnPauseEffectTimer(FXeusEffectTimerHandle Handle)
+{
+	FXeusEffectTimer* timer = EffectTimers.Find(Handle.Id);
+	if (!timer || !timer->bPaused)
+		return;
+
+	timer->bPaused = false;
+	timer->FireTime = EffectTime + timer->Remaining;
+	QueueEffectTimer(Handle.Id, *timer);
+}
+
+bool UXeusAbilitySystemComponent::IsEffectTimerActive(FXeusEffectTimerHandle Handle) const
+{
+	const FXeusEffectTimer* timer = EffectTimers.Find(Handle.Id);
+	return timer && !timer->bPaused;
+}
+
+bool UXeusAbilitySystemComponent::IsEffectTimerPaused(FXeusEffectTimerHandle Handle) const
+{
+	const FXeusEffectTimer* timer = EffectTimers.Find(Handle.Id);
+	return timer && timer->bPaused;
+}
+
+float UXeusAbilitySystemComponent::GetEffectTimerRemaining(FXeusEffectTimerHandle Handle) const
+{
+	const FXeusEffectTimer* timer = EffectTimers.Find(Handle.Id);
+	if (!timer)
+		return -1.0f;
+	return static_cast<float>(timer->bPaused ? timer->Remaining : timer->FireTime - EffectTime);
+}
+
+FName UXeusAbilitySystemComponent::GetSaveId() const
+{
+	if (!SaveId.IsNone())
+		return SaveId;
+	const AActor* owner = GetOwner();
+	return owner ? FName(*owner->GetPathName()) : NAME_None;
+}
+
+uint32 UXeusAbilitySystemComponent::GetStateRevision() const
+{
+	return StateRevision;
+}
+
+void UXeusAbilitySystemComponent::MarkStateChanged()
+{
+	++StateRevision;
+}
+
+FXeusAbilitySystemSnapshot UXeusAbilitySystemComponent::CaptureSnapshot()
+{
+	FXeusAbilitySystemSnapshot snapshot;
+	CaptureSnapshotTo(snapshot);
+	return snapshot;
+}
+
+void UXeusAbilitySystemComponent::CaptureSnapshotTo(FXeusAbilitySystemSnapshot& OutSnapshot)
+{
+	OutSnapshot.Version = FXeusAbilitySystemSnapshot::CurrentVersion;
+	OutSnapshot.Data.Reset();
+	FMemoryWriter writer(OutSnapshot.Data);
+
+	// Tables of classes and runtime objects, records refer to them by index
+	TArray<UClass*> classes;
+	TArray<UObject*> objects;
+	for (const UXeusAttribute* attribute : Attributes)
+		if (attribute)
+			classes.AddUnique(attribute->GetClass());
+	for (const UXeusEffect* effect : Effects)
+	{
+		if (!effect)
+			continue;
+		classes.AddUnique(effect->GetClass());
+		for (int32 i = 0; i < effect->GetStackCount(); ++i)
+			if (UObject* source = effect->GetStack(i).Source.Get())
+				objects.AddUnique(source);
+		if (AActor* instigator = effect->GetInstigator())
+			objects.AddUnique(instigator);
+		if (UObject* source = effect->GetEffectSource())
+			objects.AddUnique(source);
+	}
+
+	// Classes usually share few packages, so package names are written once
+	TArray<FName> packages;
+	TArray<int32> classPackages;
+	classPackages.Reserve(classes.Num());
+	for (const UClass* cls : classes)
+		classPackages.Add(packages.AddUnique(cls->GetOutermost()->GetFName()));
+
+	uint32 magic = FXeusAbilitySystemSnapshot::Magic;
+	bool bPaused = bEffectsPaused;
+	writer << magic;
+	writer << EffectTime;
+	writer << EffectTimeScale;
+	writer << bPaused;
+
+	int32 packageCount = packages.Num();
+	writer << packageCount;
+	for (const FName& package : packages)
+	{
+		FString name = package.ToString();
+		writer << name;
+	}
+
+	int32 classCount = classes.Num();
+	writer << classCount;
+	for (int32 i = 0; i < classCount; ++i)
+	{
+		FString name = classes[i]->GetName();
+		writer << classPackages[i];
+		writer << name;
+	}
+
+	int32 objectCount = objects.Num();
+	writer << objectCount;
+	for (const UObject* object : objects)
+	{
+		FString path = object->GetPathName();
+		writer << path;
+	}
+
+	int32 attributeCount = 0;
+	for (const UXeusAttribute* attribute : Attributes)
+		if (attribute)
+			++attributeCount;
+	writer << attributeCount;
+	for (UXeusAttribute* attribute : Attributes)
+	{
+		if (!attribute)
+			continue;
+		int32 classIndex = classes.Find(attribute->GetClass());
+		writer << classIndex;
+		WriteSizedRecord(writer, [attribute](FArchive& Ar) { attribute->SerializeState(Ar); });
+	}
+
+	int32 effectCount = 0;
+	for (const UXeusEffect* effect : Effects)
+		if (effect)
+			++effectCount;
+	writer << effectCount;
+	for (UXeusEffect* effect : Effects)
+	{
+		if (!effect)
+			continue;
+		int32 classIndex = classes.Find(effect->GetClass());
+		writer << classIndex;
+		WriteSizedRecord(writer, [effect, &objects](FArchive& Ar)
+		{
+			effect->SerializeState(Ar);
+
+			int32 stackCount = effect->GetStackCount();
+			Ar << stackCount;
+			for (int32 i = 0; i < stackCount; ++i)
+			{
+				int32 objectIndex = objects.Find(effect->GetStack(i).Source.Get());
+				Ar << objectIndex;
+			}
+
+			int32 instigatorIndex = objects.Find(effect->GetInstigator());
+			int32 sourceIndex = objects.Find(effect->GetEffectSource());
+			Ar << instigatorIndex;
+			Ar << sourceIndex;
+
+			FXeusEffectSettings settings = effect->GetAppliedSettings();
+			SerializeEffectSettings(Ar, settings);
+		});
+	}
+}
+
+/**
+ * Save or load settings of effect in snapshot record
+ */
+static void SerializeEffectSettings(FArchive& Ar, FXeusEffectSettings& Settings)
+{
+	Ar << Settings.bOverrideMagnitude;
+	Ar << Settings.bOverrideDuration;
+	Ar << Settings.bOverridePeriod;
+	Ar << Settings.Magnitude;
+	Ar << Settings.Duration;
+	Ar << Settings.Period;
+
+	int32 modifierCount = Settings.Modifiers.Num();
+	Ar << modifierCount;
+	if (Ar.IsLoading())
+		Settings.Modifiers.SetNum(FMath::Max(modifierCount, 0));
+	for (FXeusEffectModifier& mod : Settings.Modifiers)
+	{
+		Ar << mod.UniquedId;
+		Ar << mod.Value;
+	}
+}
+
+void UXeusAbilitySystemComponent::WriteSizedRecord(FArchive& Ar, TFunctionRef<void(FArchive&)> Write)
+{
+	// Size of record lets reader skip records whose class does not exist anymore
+	int32 size = 0;
+	const int64 sizePos = Ar.Tell();
+	Ar << size;
+	Write(Ar);
+	const int64 endPos = Ar.Tell();
+	size = static_cast<int32>(endPos - sizePos - sizeof(int32));
+	Ar.Seek(sizePos);
+	Ar << size;
+	Ar.Seek(endPos);
+}
+
+/**
+ * Read class table of snapshot
+ * Version 1 stored full class paths, later versions store package table and class names
+ */
+static bool ReadSnapshotClassPaths(FArchive& Ar, int32 Version, TArray<FString>& OutPaths)
+{
+	TArray<FString> packages;
+	if (Version >= 2)
+	{
+		int32 packageCount = 0;
+		Ar << packageCount;
+		if (Ar.IsError() || packageCount < 0)
+			return false;
+		packages.SetNum(packageCount);
+		for (FString& package : packages)
+			Ar << package;
+	}
+
+	int32 classCount = 0;
+	Ar << classCount;
+	if (Ar.IsError() || classCount < 0)
+		return false;
+
+	OutPaths.Reset(classCount);
+	for (int32 i = 0; i < classCount && !Ar.IsError(); ++i)
+	{
+		if (Version >= 2)
+		{
+			int32 packageIndex = INDEX_NONE;
+			FString name;
+			Ar << packageIndex;
+			Ar << name;
+			OutPaths.Add(packages.IsValidIndex(packageIndex) ? packages[packageIndex] + TEXT(".") + name : FString());
+		}
+		else
+		{
+			Ar << OutPaths.AddDefaulted_GetRef();
+		}
+	}
+	return !Ar.IsError();
+}
+
+/**
+ * Position of one sized record in snapshot
+ */
+struct FXeusSnapshotRecord
+{
+	UClass* Class = nullptr;
+	int64 DataPos = 0;
+	int64 EndPos = 0;
+};
+
+/**
+ * Read and bounds-check table of sized records without reading their data
+ */
+static bool ReadSnapshotRecords(FArchive& Ar, const TArray<UClass*>& Classes, TArray<FXeusSnapshotRecord>& OutRecords)
+{
+	int32 count = 0;
+	Ar << count;
+	if (Ar.IsError() || count < 0)
+		return false;
+
+	OutRecords.Reset();
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 classIndex = INDEX_NONE;
+		int32 size = 0;
+		Ar << classIndex;
+		Ar << size;
+		const int64 endPos = Ar.Tell() + size;
+		if (Ar.IsError() || size < 0 || endPos > Ar.TotalSize())
+			return false;
+
+		FXeusSnapshotRecord& record = OutRecords.AddDefaulted_GetRef();
+		record.Class = Classes.IsValidIndex(classIndex) ? Classes[classIndex] : nullptr;
+		record.DataPos = Ar.Tell();
+		record.EndPos = endPos;
+		Ar.Seek(endPos);
+	}
+	return true;
+}
+
+bool UXeusAbilitySystemComponent::RestoreSnapshot(const FXeusAbilitySystemSnapshot& Snapshot, bool bFireStartEvents,
+                                                  bool bFireEndEvents)
+{
+	// Newer snapshot replaces one that waits for its classes
+	if (SnapshotClassesHandle.IsValid())
+	{
+		SnapshotClassesHandle->CancelHandle();
+		SnapshotClassesHandle.Reset();
+	}
+	return RestoreSnapshotImpl(Snapshot, bFireStartEvents, bFireEndEvents, true);
+}
+
+void UXeusAbilitySystemComponent::OnSnapshotClassesLoaded(FXeusAbilitySystemSnapshot Snapshot, bool bFireStartEvents,
+                                                          bool bFireEndEvents)
+{
+	SnapshotClassesHandle.Reset();
+	RestoreSnapshotImpl(Snapshot, bFireStartEvents, bFireEndEvents, false);
+}
+
+bool UXeusAbilitySystemComponent::RestoreSnapshotImpl(const FXeusAbilitySystemSnapshot& Snapshot,
+                                                      bool bFireStartEvents, bool bFireEndEvents,
+                                                      bool bLoadMissingClasses)
+{
+	if (!Snapshot.IsValid() || Snapshot.Version > FXeusAbilitySystemSnapshot::CurrentVersion)
+		return false;
+
+	FMemoryReader reader(Snapshot.Data);
+
+	uint32 magic = 0;
+	double effectTime = 0.0;
+	float timeScale = 1.0f;
+	bool bPaused = false;
+	reader << magic;
+	if (magic != FXeusAbilitySystemSnapshot::Magic)
+		return false;
+	reader << effectTime;
+	reader << timeScale;
+	reader << bPaused;
+
+	TArray<FString> paths;
+	if (!ReadSnapshotClassPaths(reader, Snapshot.Version, paths))
+		return false;
+
+	TArray<UClass*> classes;
+	TArray<FSoftObjectPath> missing;
+	classes.Reserve(paths.Num());
+	for (const FString& path : paths)
+	{
+		UClass* cls = path.IsEmpty() ? nullptr : FindObject<UClass>(nullptr, *path);
+		if (!cls && !path.IsEmpty())
+		{
+			if (bLoadMissingClasses)
+				missing.Add(FSoftObjectPath(path));
+			else
+				UE_LOG(AbilitySystemLog, Warning, TEXT("%s: snapshot class %s was not found"), *GetNameSafe(GetOwner()), *path);
+		}
+		classes.Add(cls);
+	}
+
+	// State is not touched until all classes are streamed, game thread is never blocked by loading
+	if (missing.Num() > 0)
+	{
+		TSharedPtr<FStreamableHandle> handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+			missing, FStreamableDelegate::CreateUObject(this, &UXeusAbilitySystemComponent::OnSnapshotClassesLoaded,
+			                                            Snapshot, bFireStartEvents, bFireEndEvents));
+		if (handle.IsValid() && !handle->HasLoadCompleted())
+			SnapshotClassesHandle = handle;
+		return true;
+	}
+
+	// Runtime objects are only found, they are not loaded
+	TArray<UObject*> objects;
+	if (Snapshot.Version >= 2)
+	{
+		int32 objectCount = 0;
+		reader << objectCount;
+		if (reader.IsError() || objectCount < 0)
+			return false;
+		objects.Reserve(objectCount);
+		for (int32 i = 0; i < objectCount && !reader.IsError(); ++i)
+		{
+			FString path;
+			reader << path;
+			objects.Add(FindObject<UObject>(nullptr, *path));
+		}
+	}
+
+	// Current state is not touched until every record is known to be complete
+	TArray<FXeusSnapshotRecord> attributeRecords;
+	TArray<FXeusSnapshotRecord> effectRecords;
+	if (!ReadSnapshotRecords(reader, classes, attributeRecords) || !ReadSnapshotRecords(reader, classes, effectRecords))
+	{
+		UE_LOG(AbilitySystemLog, Warning, TEXT("%s: snapshot is truncated, state was not restored"),
+		       *GetNameSafe(GetOwner()));
+		return false;
+	}
+
+	// Effects are destroyed first, their aggregated multipliers are restored with attributes
+	RemoveAllEffectsImpl(bFireEndEvents);
+	EffectTime = effectTime;
+	EffectTimeScale = timeScale;
+	bEffectsPaused = bPaused;
+
+	TArray<UXeusAttribute*> restoredAttributes;
+	restoredAttributes.Reserve(attributeRecords.Num());
+	for (const FXeusSnapshotRecord& record : attributeRecords)
+	{
+		UClass* cls = record.Class;
+		UXeusAttribute* attribute = cls ? GetAttributeByClass(cls) : nullptr;
+		if (!attribute && cls && cls->IsChildOf(UXeusAttribute::StaticClass()))
+			attribute = AddAttributeImpl(cls);
+
+		if (attribute)
+		{
+			reader.Seek(record.DataPos);
+			attribute->SerializeState(reader);
+			MarkDependentsDirty(attribute);
+			restoredAttributes.Add(attribute);
+		}
+	}
+
+	// Aggregates of effects that were not restored should not stay on attributes
+	for (UXeusAttribute* attribute : Attributes)
+		for (int32 type = 0; type < static_cast<int32>(EAttributeMultiplierType::MAX); ++type)
+			attribute->RemoveMult(GetModifierAggregateId(static_cast<EAttributeMultiplierType>(type)));
+
+	TArray<UXeusEffect*> restoredEffects;
+	restoredEffects.Reserve(effectRecords.Num());
+	for (const FXeusSnapshotRecord& record : effectRecords)
+	{
+		UClass* cls = record.Class;
+		if (cls && cls->IsChildOf(UXeusEffect::StaticClass()) && !cls->HasAnyClassFlags(CLASS_Abstract))
+		{
+			reader.Seek(record.DataPos);
+			UXeusEffect* effect = NewEffectInstance(cls);
+			effect->InitStacks(nullptr, static_cast<float>(GetEffectTime()));
+			effect->SerializeState(reader);
+			if (Snapshot.Version >= 2)
+			{
+				int32 stackCount = 0;
+				reader << stackCount;
+				for (int32 stack = 0; stack < stackCount && !reader.IsError(); ++stack)
+				{
+					int32 objectIndex = INDEX_NONE;
+					reader << objectIndex;
+					effect->SetStackSource(stack, objects.IsValidIndex(objectIndex) ? objects[objectIndex] : nullptr);
+				}
+			}
+			if (Snapshot.Version >= 3)
+			{
+				// Context is set before link, so effect is indexed by its instigator
+				int32 instigatorIndex = INDEX_NONE;
+				int32 sourceIndex = INDEX_NONE;
+				reader << instigatorIndex;
+				reader << sourceIndex;
+				effect->SetContext(FXeusEffectContext(
+					objects.IsValidIndex(instigatorIndex) ? Cast<AActor>(objects[instigatorIndex]) : nullptr,
+					objects.IsValidIndex(sourceIndex) ? objects[sourceIndex] : nullptr));
+			}
+			if (Snapshot.Version >= 4)
+			{
+				FXeusEffectSettings settings;
+				SerializeEffectSettings(reader, settings);
+				effect->RestoreAppliedSettings(settings);
+			}
+			LinkEffect(effect);
+			restoredEffects.Add(effect);
+		}
+	}
+
+	for (UXeusEffect* effect : restoredEffects)
+	{
+		effect->NotifyRestored(this);
+		if (bFireStartEvents)
+			OnEffectStartedWork.Broadcast(this, effect);
+	}
+
+	if (bFireStartEvents)
+	{
+		for (UXeusAttribute* attribute : restoredAttributes)
+			OnValueChanged.Broadcast(this, attribute, attribute->GetCurrentValue());
+	}
+
+	FlushDerivedAttributes();
+	if (QuerySubsystem)
+		QuerySubsystem->RefreshComponent(this);
+	MarkStateChanged();
+	OnStateReset.Broadcast(this);
+	return !reader.IsError();
+}
+
+#pragma region Effects
+
+void UXeusAbilitySystemComponent::Effect_NeedRemove(UXeusEffect* Effect)
+{
+	for (int32 i = 0; i < Effects.Num(); ++i)
+		if (Effects[i] && Effects[i] != Effect)
+			Effects[i]->EffectRemoving(Effect);
+
+	OnEffectEndWork.Broadcast(this, Effect);
+	RemoveEffectInstance(Effect);
+}
+
+void UXeusAbilitySystemComponent::BP_AddEffect(TSubclassOf<UXeusEffect> InClass, bool& bSuccess,
+                                               UXeusEffect*& OutEffect)
+{
+	OutEffect = AddEffectImpl(InClass);
+	bSuccess = IsValid(OutEffect);
+}
+
+// ReSharper disable once CppMemberFunctionMayBeConst
+UXeusEffect* UXeusAbilitySystemComponent::StackEffect(TSubclassOf<UXeusEffect> InClass, UObject* Source)
+{
+	UXeusEffect* effect = nullptr;
+	if (UXeusEffect** found = StackableEffects.Find(InClass))
+	{
+		effect = *found;
+	}
+	else
+	{
+		for (const auto& pair : StackableEffects)
+		{
+			if (pair.Value->IsA(InClass))
+			{
+				effect = pair.Value;
+				break;
+			}
+		}
+	}
+
+	if (!effect)
+		return nullptr;
+
+	effect->AddStack(Source);
+	effect->Stack(InClass);
+	return effect;
+}
+
+void UXeusAbilitySystemComponent::PushEffect(UXeusEffect* InEffect)
+{
+	for (int32 i = 0; i < Effects.Num(); ++i)
+		Effects[i]->EffectAdded(InEffect);
+
+	LinkEffect(InEffect);
+
+	OnEffectStartedWork.Broadcast(this, InEffect);
+	InEffect->NotifyBeginWork(this);
+}
+
+void UXeusAbilitySystemComponent::LinkEffect(UXeusEffect* InEffect)
+{
+	InEffect->OnNeedRemove.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::Effect_NeedRemove);
+	if (InEffect->GetRollbackSerial() == 0)
+		InEffect->SetRollbackSerial(++LastEffectSerial);
+
+	Effects.AddUnique(InEffect);
+	MarkStateChanged();
+	AllocateEffectHandle(InEffect);
+	RegisterEffectModifiers(InEffect);
+	RegisterEffectTags(InEffect);
+	if (InEffect->GetIsStackable())
+		StackableEffects.Add(InEffect->GetClass(), InEffect);
+	if (InEffect->GetInstigatorKey() != FObjectKey())
+		EffectsByInstigator.FindOrAdd(InEffect->GetInstigatorKey()).Add(InEffect);
+	AcquireEffectIcon(InEffect);
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyEffectAdded(this, InEffect);
+}
+
+UXeusEffect* UXeusAbilitySystemComponent::NewEffectInstance(TSubclassOf<UXeusEffect> InClass)
+{
+	UWorld* world = GetWorld();
+	if (world && GetDefault<UXeusEffect>(InClass)->GetIsPoolable())
+		if (UXeusAreaEffectSubsystem* areaSubsystem = world->GetSubsystem<UXeusAreaEffectSubsystem>())
+			return areaSubsystem->AcquireEffect(InClass);
+
+	return UXeusEffect::CreateEffect(InClass, GetOwner());
+}
+
+void UXeusAbilitySystemComponent::DestroyEffectInstance(UXeusEffect* InEffect)
+{
+	UWorld* world = GetWorld();
+	if (world && InEffect->GetIsPoolable())
+	{
+		if (UXeusAreaEffectSubsystem* areaSubsystem = world->GetSubsystem<UXeusAreaEffectSubsystem>())
+		{
+			areaSubsystem->ReleaseEffect(InEffect);
+			return;
+		}
+	}
+	InEffect->ConditionalBeginDestroy();
+}
+
+bool UXeusAbilitySystemComponent::RemoveEffect(TSubclassOf<UXeusEffect> InClass)
+{
+	return RemoveEffectInstance(GetEffectByClass(InClass));
+}
+
+bool UXeusAbilitySystemComponent::RemoveEffectInstance(UXeusEffect* Effect)
+{
+	if (!Effect || !Effects.Contains(Effect))
+		return false;
+
+	for (int32 i = 0; i < Effects.Num(); ++i)
+		if (Effects[i] != Effect)
+			Effects[i]->EffectRemoving(Effect);
+
+	UnlinkEffect(Effect);
+	return true;
+}
+
+void UXeusAbilitySystemComponent::UnlinkEffect(UXeusEffect* InEffect)
+{
+	UnregisterEffectModifiers(InEffect);
+	UnregisterEffectTags(InEffect);
+	ReleaseEffectIcon(InEffect);
+	if (const UXeusEffect* const* stackable = StackableEffects.Find(InEffect->GetClass()))
+		if (*stackable == InEffect)
+			StackableEffects.Remove(InEffect->GetClass());
+	if (TArray<UXeusEffect*>* instigated = EffectsByInstigator.Find(InEffect->GetInstigatorKey()))
+	{
+		instigated->RemoveSingleSwap(InEffect, false);
+		if (instigated->Num() == 0)
+			EffectsByInstigator.Remove(InEffect->GetInstigatorKey());
+	}
+
+	const int32 index = Effects.Find(InEffect);
+	if (index == INDEX_NONE)
+		return;
+	ReleaseEffectHandle(InEffect);
+	MarkStateChanged();
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyEffectRemoved(this, InEffect);
+	OnEffectUnlinked.Broadcast(this, InEffect);
+	DestroyEffectInstance(Effects[index]);
+	Effects[index] = nullptr;
+	Effects.RemoveAt(index);
+}
+
+void UXeusAbilitySystemComponent::AllocateEffectHandle(UXeusEffect* InEffect)
+{
+	const int32 index = FreeEffectSlots.Num() > 0 ? FreeEffectSlots.Pop(false) : EffectSlots.AddDefaulted();
+
+	FXeusEffectSlot& slot = EffectSlots[index];
+	slot.Effect = InEffect;
+	InEffect->SetHandle(FXeusEffectHandle(index, slot.Generation, EffectHandleOwner));
+}
+
+void UXeusAbilitySystemComponent::ReleaseEffectHandle(UXeusEffect* InEffect)
+{
+	const FXeusEffectHandle handle = InEffect->GetHandle();
+	if (!EffectSlots.IsValidIndex(handle.Index) || EffectSlots[handle.Index].Effect != InEffect)
+		return;
+
+	FXeusEffectSlot& slot = EffectSlots[handle.Index];
+	slot.Effect = nullptr;
+	// Zero is generation of invalid handle
+	slot.Generation = slot.Generation == MAX_int32 ? 1 : slot.Generation + 1;
+	FreeEffectSlots.Add(handle.Index);
+	InEffect->SetHandle(FXeusEffectHandle());
+}
+
+void UXeusAbilitySystemComponent::RegisterEffectModifiers(UXeusEffect* InEffect)
+{
+	const TArray<FXeusEffectAttributeLink>& targets = InEffect->GetModifierTargets();
+	if (targets.Num() == 0)
+		return;
+
+	InEffect->OnTotalModifierChanged.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::Effect_ModifierChanged);
+
+	for (const FXeusEffectAttributeLink& link : targets)
+	{
+		if (!link.Attribute)
+			continue;
+
+		FXeusModifierAggregate* aggregate = ModifierAggregates.Find(link.Attribute);
+		if (!aggregate)
+		{
+			aggregate = &ModifierAggregates.Add(link.Attribute);
+			aggregate->Attribute = GetAttributeByClass(link.Attribute);
+		}
+		aggregate->Links.Emplace(InEffect, link.Type);
+		UpdateModifierAggregate(*aggregate, link.Type);
+	}
+}
+
+void UXeusAbilitySystemComponent::UnregisterEffectModifiers(UXeusEffect* InEffect)
+{
+	const TArray<FXeusEffectAttributeLink>& targets = InEffect->GetModifierTargets();
+	if (targets.Num() == 0)
+		return;
+
+	InEffect->OnTotalModifierChanged.RemoveDynamic(this, &UXeusAbilitySystemComponent::Effect_ModifierChanged);
+
+	for (const FXeusEffectAttributeLink& link : targets)
+	{
+		FXeusModifierAggregate* aggregate = ModifierAggregates.Find(link.Attribute);
+		if (!aggregate)
+			continue;
+
+		aggregate->Links.RemoveAllSwap([InEffect](const TPair<UXeusEffect*, EAttributeMultiplierType>& Link)
+		{
+			return Link.Key == InEffect;
+		});
+		UpdateModifierAggregate(*aggregate, link.Type);
+	}
+
+	for (const FXeusEffectAttributeLink& link : targets)
+	{
+		const FXeusModifierAggregate* aggregate = ModifierAggregates.Find(link.Attribute);
+		if (aggregate && aggregate->Links.Num() == 0)
+			ModifierAggregates.Remove(link.Attribute);
+	}
+}
+
+void UXeusAbilitySystemComponent::UpdateModifierAggregate(const FXeusModifierAggregate& Aggregate,
+                                                          EAttributeMultiplierType Type) const
+{
+	if (!IsValid(Aggregate.Attribute))
+		return;
+
+	float product = 1.0f;
+	bool bLinked = false;
+	for (const auto& link : Aggregate.Links)
+	{
+		if (link.Value == Type)
+		{
+			product *= link.Key->GetTotalModifier();
+			bLinked = true;
+		}
+	}
+
+	const FName id = GetModifierAggregateId(Type);
+	if (bLinked)
+		Aggregate.Attribute->SetMult(FAttributeMultiplier(id, product, Type));
+	else
+		Aggregate.Attribute->RemoveMult(id);
+}
+
+void UXeusAbilitySystemComponent::Effect_ModifierChanged(UXeusEffect* Effect, float Value)
+{
+	MarkStateChanged();
+	for (const FXeusEffectAttributeLink& link : Effect->GetModifierTargets())
+	{
+		if (const FXeusModifierAggregate* aggregate = ModifierAggregates.Find(link.Attribute))
+		{
+			UpdateModifierAggregate(*aggregate, link.Type);
+		}
+	}
+}
+
+void UXeusAbilitySystemComponent::RegisterEffectTags(UXeusEffect* InEffect)
+{
+	for (const FGameplayTag& tag : InEffect->GetGrantedTagsWithParents())
+	{
+		EffectsByTag.FindOrAdd(tag).Add(InEffect);
+		if (++GrantedTagCounts.FindOrAdd(tag) == 1)
+			OnGameplayTagCountChanged.Broadcast(this, tag, 1);
+	}
+
+	for (const FGameplayTag& tag : InEffect->GetBlockedTags())
+		++BlockedTagCounts.FindOrAdd(tag);
+}
+
+void UXeusAbilitySystemComponent::UnregisterEffectTags(UXeusEffect* InEffect)
+{
+	for (const FGameplayTag& tag : InEffect->GetGrantedTagsWithParents())
+	{
+		if (TArray<UXeusEffect*>* effects = EffectsByTag.Find(tag))
+		{
+			effects->RemoveSingleSwap(InEffect, false);
+			if (effects->Num() == 0)
+				EffectsByTag.Remove(tag);
+		}
+
+		int32* count = GrantedTagCounts.Find(tag);
+		if (count && --(*count) <= 0)
+		{
+			GrantedTagCounts.Remove(tag);
+			OnGameplayTagCountChanged.Broadcast(this, tag, 0);
+		}
+	}
+
+	for (const FGameplayTag& tag : InEffect->GetBlockedTags())
+	{
+		int32* count = BlockedTagCounts.Find(tag);
+		if (count && --(*count) <= 0)
+			BlockedTagCounts.Remove(tag);
+	}
+}
+
+FName UXeusAbilitySystemComponent::GetModifierAggregateId(EAttributeMultiplierType Type)
+{
+	return FName(TEXT("EffectModifierAggregate"), static_cast<int32>(Type) + 1);
+}
+
+bool UXeusAbilitySystemComponent::FilterIncomingEffect(TSubclassOf<UXeusEffect> InClass, UObject* Source)
+{
+	if (!InClass)
+		return false;
+
+	const EXeusEffectRejectReason reason = CheckEffectApplication(InClass, Source);
+	if (reason == EXeusEffectRejectReason::None)
+		return true;
+
+	++RejectCounts[static_cast<int32>(reason)];
+	OnEffectRejected.Broadcast(this, InClass, Source, reason);
+	return false;
+}
+
+bool UXeusAbilitySystemComponent::CanApplyEffect_Implementation(TSubclassOf<UXeusEffect> InClass,
+                                                                UObject* Source) const
+{
+	return true;
+}
+
+EXeusEffectRejectReason UXeusAbilitySystemComponent::CheckEffectApplication(TSubclassOf<UXeusEffect> InClass,
+                                                                            UObject* Source) const
+{
+	if (!InClass)
+		return EXeusEffectRejectReason::None;
+
+	if (IsImmuneToEffect(InClass))
+		return EXeusEffectRejectReason::Immune;
+
+	if (ImmuneTagCounts.Num() > 0)
+	{
+		for (const FGameplayTag& tag : GetDefault<UXeusEffect>(InClass)->GetGrantedTagsWithParents())
+			if (ImmuneTagCounts.Contains(tag))
+				return EXeusEffectRejectReason::ImmuneTag;
+	}
+
+	if (IsEffectBlocked(InClass))
+		return EXeusEffectRejectReason::Blocked;
+
+	if (EffectFilter.IsBound() && !EffectFilter.Execute(this, InClass, Source))
+		return EXeusEffectRejectReason::Filter;
+
+	if (!CanApplyEffect(InClass, Source))
+		return EXeusEffectRejectReason::Filter;
+
+	return EXeusEffectRejectReason::None;
+}
+
+void UXeusAbilitySystemComponent::AddEffectImmunity(TSubclassOf<UXeusEffect> InClass)
+{
+	if (InClass)
+		++ImmuneClassCounts.FindOrAdd(InClass);
+}
+
+void UXeusAbilitySystemComponent::RemoveEffectImmunity(TSubclassOf<UXeusEffect> InClass)
+{
+	int32* count = ImmuneClassCounts.Find(InClass);
+	if (count && --(*count) <= 0)
+		ImmuneClassCounts.Remove(InClass);
+}
+
+bool UXeusAbilitySystemComponent::IsImmuneToEffect(TSubclassOf<UXeusEffect> InClass) const
+{
+	if (ImmuneClassCounts.Num() == 0)
+		return false;
+
+	// Immunity to parent class covers all its children
+	for (UClass* current = InClass; current; current = current->GetSuperClass())
+	{
+		if (ImmuneClassCounts.Contains(current))
+			return true;
+		if (current == UXeusEffect::StaticClass())
+			break;
+	}
+	return false;
+}
+
+void UXeusAbilitySystemComponent::AddImmunityTag(FGameplayTag Tag)
+{
+	if (Tag.IsValid())
+		++ImmuneTagCounts.FindOrAdd(Tag);
+}
+
+void UXeusAbilitySystemComponent::RemoveImmunityTag(FGameplayTag Tag)
+{
+	int32* count = ImmuneTagCounts.Find(Tag);
+	if (count && --(*count) <= 0)
+		ImmuneTagCounts.Remove(Tag);
+}
+
+int32 UXeusAbilitySystemComponent::GetRejectCount(EXeusEffectRejectReason Reason) const
+{
+	const int32 index = static_cast<int32>(Reason);
+	return index < static_cast<int32>(EXeusEffectRejectReason::MAX) ? RejectCounts[index] : 0;
+}
+
+void UXeusAbilitySystemComponent::ResetRejectCounts()
+{
+	FMemory::Memzero(RejectCounts);
+}
+
+UXeusEffect* UXeusAbilitySystemComponent::AddEffectImpl(TSubclassOf<UXeusEffect> InClass)
+{
+	return AddEffectFromSource(InClass, nullptr);
+}
+
+UXeusEffect* UXeusAbilitySystemComponent::AddEffectFromSource(TSubclassOf<UXeusEffect> InClass, UObject* Source)
+{
+	return AddEffectWithContext(InClass, FXeusEffectContext(nullptr, Source));
+}
+
+UXeusEffect* UXeusAbilitySystemComponent::AddEffectWithContext(TSubclassOf<UXeusEffect> InClass,
+                                                               const FXeusEffectContext& Context)
+{
+	UObject* source = Context.Source.Get();
+	if (!FilterIncomingEffect(InClass, source))
+		return nullptr;
+
+	if (UXeusEffect* eff = StackEffect(InClass, source))
+		return eff;
+
+	UXeusEffect* Result = NewEffectInstance(InClass);
+	Result->SetContext(Context);
+	Result->InitStacks(source, static_cast<float>(GetEffectTime()));
+	PushEffect(Result);
+
+	return Result;
+}
+
+UXeusEffect* UXeusAbilitySystemComponent::AddEffectWithSettingsImpl(TSubclassOf<UXeusEffect> InClass,
+                                                                    const FXeusEffectSettings& Settings,
+                                                                    const FXeusEffectContext& Context)
+{
+	UObject* source = Context.Source.Get();
+	if (!FilterIncomingEffect(InClass, source))
+		return nullptr;
+
+	if (UXeusEffect* eff = StackEffect(InClass, source))
+	{
+		UE_LOG(AbilitySystemLog, Verbose, TEXT("%s: %s was stacked, its settings were not applied"),
+		       *GetNameSafe(GetOwner()), *GetNameSafe(InClass));
+		return eff;
+	}
+
+	UXeusEffect* Result = NewEffectInstance(InClass);
+	Result->SetContext(Context);
+	Result->InitStacks(source, static_cast<float>(GetEffectTime()));
+	Result->Setup(Settings);
+	PushEffect(Result);
+
+	return Result;
 }
 
-void UXeusAbilitySystemComponent::TickComponent(float DeltaTime, ELevelTick TickType,
-                                                FActorComponentTickFunction* ThisTickFunction)
+UXeusEffect* UXeusAbilitySystemComponent::AddEffectWithSpec(TSubclassOf<UXeusEffect> InClass,
+                                                            const FXeusEffectSettings& Settings,
+                                                            const FXeusEffectContext& Context)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	return AddEffectWithSettingsImpl(InClass, Settings, Context);
 }
 
-#pragma region Effects
-
-void UXeusAbilitySystemComponent::Effect_NeedRemove(UXeusEffect* Effect)
+UXeusEffect* UXeusAbilitySystemComponent::AddEffectFromSpecAsset(const UXeusEffectSpec* Spec,
+                                                                 const FXeusEffectContext& Context)
 {
-	for (int32 i = 0; i < Effects.Num(); ++i)
-		if (Effects[i] && Effects[i] != Effect)
-			Effects[i]->EffectRemoving(Effect);
-
-	OnEffectEndWork.Broadcast(this, Effect);
-	RemoveEffect(Effect->GetClass());
+	if (!Spec)
+		return nullptr;
+	return AddEffectWithSettingsImpl(Spec->EffectClass, Spec->Settings, Context);
 }
 
-void UXeusAbilitySystemComponent::BP_AddEffect(TSubclassOf<UXeusEffect> InClass, bool& bSuccess,
-                                               UXeusEffect*& OutEffect)
+FXeusEffectHandle UXeusAbilitySystemComponent::AddEffectWithHandle(TSubclassOf<UXeusEffect> InClass,
+                                                                  const FXeusEffectContext& Context)
 {
-	OutEffect = AddEffectImpl(InClass);
-	bSuccess = IsValid(OutEffect);
+	const UXeusEffect* effect = AddEffectWithContext(InClass, Context);
+	return effect ? effect->GetHandle() : FXeusEffectHandle();
 }
 
-// ReSharper disable once CppMemberFunctionMayBeConst
-UXeusEffect* UXeusAbilitySystemComponent::StackEffect(TSubclassOf<UXeusEffect> InClass)
+FXeusEffectHandle UXeusAbilitySystemComponent::AddEffectWithSpecHandle(TSubclassOf<UXeusEffect> InClass,
+                                                                      const FXeusEffectSettings& Settings,
+                                                                      const FXeusEffectContext& Context)
 {
-	if (UXeusEffect* effect = GetEffectByClass(InClass))
-	{
-		if (effect->GetIsStackable())
-		{
-			effect->Stack(InClass);
-			return effect;
-		}
-		return nullptr;
-	}
-	return nullptr;
+	const UXeusEffect* effect = AddEffectWithSettingsImpl(InClass, Settings, Context);
+	return effect ? effect->GetHandle() : FXeusEffectHandle();
 }
 
-void UXeusAbilitySystemComponent::PushEffect(UXeusEffect* InEffect)
+bool UXeusAbilitySystemComponent::AddEffectSoft(TSoftClassPtr<UXeusEffect> InClass)
 {
-	InEffect->OnNeedRemove.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::Effect_NeedRemove);
+	if (InClass.IsNull())
+		return false;
 
-	for (int32 i = 0; i < Effects.Num(); ++i)
-		Effects[i]->EffectAdded(InEffect);
+	if (UClass* loaded = InClass.Get())
+		return IsValid(AddEffectImpl(loaded));
 
-	int32 index = Effects.AddUnique(InEffect);
+	TSharedPtr<FStreamableHandle> handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		InClass.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &UXeusAbilitySystemComponent::OnSoftEffectLoaded, InClass));
+	if (handle.IsValid() && !handle->HasLoadCompleted())
+		PendingEffectLoads.Add(handle);
 
-	OnEffectStartedWork.Broadcast(this, InEffect);
-	InEffect->NotifyBeginWork(this);
+	return false;
 }
 
-bool UXeusAbilitySystemComponent::RemoveEffect(TSubclassOf<UXeusEffect> InClass)
+void UXeusAbilitySystemComponent::OnSoftEffectLoaded(TSoftClassPtr<UXeusEffect> InClass)
 {
-	UXeusEffect* Effect = GetEffectByClass(InClass);
-	if (!Effect)
-		return false;
-
-	for (int32 i = 0; i < Effects.Num(); ++i)
-		if (Effects[i] != Effect)
-			Effects[i]->EffectRemoving(Effect);
-
+	PendingEffectLoads.RemoveAllSwap([](const TSharedPtr<FStreamableHandle>& Handle)
+	{
+		return !Handle.IsValid() || Handle->HasLoadCompleted() || Handle->WasCanceled();
+	});
 
-	const int32 index = Effects.Find(Effect);
-	Effects[index]->ConditionalBeginDestroy();
-	Effects[index] = nullptr;
-	Effects.RemoveAt(index);
+	if (UClass* loaded = InClass.Get())
+	{
+		AddEffectImpl(loaded);
+	}
+}
 
-	return true;
+void UXeusAbilitySystemComponent::PreloadEffectBundle(UXeusEffectBundle* Bundle)
+{
+	if (!Bundle)
+		return;
+
+	const FPrimaryAssetId bundleId = Bundle->GetPrimaryAssetId();
+	if (BundleStreaming.Contains(bundleId))
+		return;
+
+	TArray<FSoftObjectPath> paths;
+	for (const auto& effectClass : Bundle->Effects)
+		if (!effectClass.IsNull())
+			paths.Add(effectClass.ToSoftObjectPath());
+
+	if (paths.Num() == 0)
+		return;
+
+	// Callback can be executed immediately if everything is already loaded
+	BundleStreaming.Add(bundleId);
+	TSharedPtr<FStreamableHandle> handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		paths, FStreamableDelegate::CreateUObject(this, &UXeusAbilitySystemComponent::OnBundleClassesLoaded,
+		                                          TWeakObjectPtr<UXeusEffectBundle>(Bundle)));
+	if (FXeusEffectBundleStreaming* streaming = BundleStreaming.Find(bundleId))
+		streaming->ClassesHandle = handle;
 }
 
-UXeusEffect* UXeusAbilitySystemComponent::AddEffectImpl(TSubclassOf<UXeusEffect> InClass)
+void UXeusAbilitySystemComponent::OnBundleClassesLoaded(TWeakObjectPtr<UXeusEffectBundle> Bundle)
 {
-	if (UXeusEffect* eff = StackEffect(InClass))
-		return eff;
+	if (!Bundle.IsValid() || !Bundle->bPreloadIcons)
+		return;
 
-	UXeusEffect* Result = UXeusEffect::CreateEffect(InClass, GetOwner());
-	PushEffect(Result);
+	FXeusEffectBundleStreaming* streaming = BundleStreaming.Find(Bundle->GetPrimaryAssetId());
+	if (!streaming)
+		return;
 
-	return Result;
+	TArray<FSoftObjectPath> icons;
+	for (const auto& effectClass : Bundle->Effects)
+	{
+		const UClass* loaded = effectClass.Get();
+		const UXeusEffect* effect = loaded ? Cast<UXeusEffect>(loaded->GetDefaultObject()) : nullptr;
+		if (effect && effect->GetIsDisplayable() && !effect->GetIcon().IsNull())
+			icons.AddUnique(effect->GetIcon().ToSoftObjectPath());
+	}
+
+	if (icons.Num() > 0)
+		streaming->IconsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(icons);
 }
 
-UXeusEffect* UXeusAbilitySystemComponent::AddEffectWithSettingsImpl(TSubclassOf<UXeusEffect> InClass,
-                                                                    FXeusEffectSettings* Settings)
+void UXeusAbilitySystemComponent::ReleaseEffectBundle(UXeusEffectBundle* Bundle)
 {
-	check(Settings);
+	if (!Bundle)
+		return;
 
-	if (UXeusEffect* eff = StackEffect(InClass))
-		return eff;
+	FXeusEffectBundleStreaming streaming;
+	if (!BundleStreaming.RemoveAndCopyValue(Bundle->GetPrimaryAssetId(), streaming))
+		return;
 
-	UXeusEffect* Result = UXeusEffect::CreateEffect(InClass, GetOwner());
-	Result->Setup(Settings);
-	PushEffect(Result);
+	if (streaming.ClassesHandle.IsValid())
+		streaming.ClassesHandle->ReleaseHandle();
+	if (streaming.IconsHandle.IsValid())
+		streaming.IconsHandle->ReleaseHandle();
+}
 
-	return Result;
+bool UXeusAbilitySystemComponent::IsEffectBundleLoaded(UXeusEffectBundle* Bundle) const
+{
+	if (!Bundle)
+		return false;
+
+	for (const auto& effectClass : Bundle->Effects)
+		if (effectClass.IsPending())
+			return false;
+	return true;
 }
 
 bool UXeusAbilitySystemComponent::StopEffect(TSubclassOf<UXeusEffect> InClass)
@@ -171,6 +1870,25 @@ bool UXeusAbilitySystemComponent::StopEffectInstance(UXeusEffect* InEffectInstan
 	return true;
 }
 
+bool UXeusAbilitySystemComponent::StopEffectByHandle(FXeusEffectHandle Handle)
+{
+	return StopEffectInstance(ResolveEffectHandle(Handle));
+}
+
+bool UXeusAbilitySystemComponent::IsEffectHandleValid(FXeusEffectHandle Handle) const
+{
+	return ResolveEffectHandle(Handle) != nullptr;
+}
+
+UXeusEffect* UXeusAbilitySystemComponent::ResolveEffectHandle(FXeusEffectHandle Handle) const
+{
+	if (Handle.Owner != EffectHandleOwner || !EffectSlots.IsValidIndex(Handle.Index))
+		return nullptr;
+
+	const FXeusEffectSlot& slot = EffectSlots[Handle.Index];
+	return slot.Generation == Handle.Generation ? slot.Effect : nullptr;
+}
+
 void UXeusAbilitySystemComponent::StopAllEffectsByClass(TSubclassOf<UXeusEffect> InClass)
 {
 	TArray<UXeusEffect*> res = Effects.FilterByPredicate([InClass](const UXeusEffect* Eff)
@@ -210,12 +1928,19 @@ UXeusEffect* UXeusAbilitySystemComponent::GetEffectByClass(TSubclassOf<UXeusEffe
 TArray<UXeusEffect*> UXeusAbilitySystemComponent::GetAllEffectsByClass(TSubclassOf<UXeusEffect> InClass) const
 {
 	TArray<UXeusEffect*> result;
+	GetAllEffectsByClassTo(InClass, result);
+	return result;
+}
+
+int32 UXeusAbilitySystemComponent::GetAllEffectsByClassTo(TSubclassOf<UXeusEffect> InClass,
+                                                          TArray<UXeusEffect*>& OutEffects) const
+{
+	OutEffects.Reset();
 	for (int32 i = 0; i < Effects.Num(); ++i)
-		if (IsValid(Effects[i]) &&
-			(Effects[i]->GetClass()->IsChildOf(InClass) || Effects[i]->IsA(InClass)))
-			result.Add(Effects[i]);
+		if (IsValid(Effects[i]) && Effects[i]->IsA(InClass))
+			OutEffects.Add(Effects[i]);
 
-	return result;
+	return OutEffects.Num();
 }
 
 TArray<UXeusEffect*> UXeusAbilitySystemComponent::GetEffects() const
@@ -223,6 +1948,113 @@ TArray<UXeusEffect*> UXeusAbilitySystemComponent::GetEffects() const
 	return Effects;
 }
 
+const TArray<UXeusEffect*>& UXeusAbilitySystemComponent::GetEffectsRef() const
+{
+	return Effects;
+}
+
+TArrayView<UXeusEffect* const> UXeusAbilitySystemComponent::GetEffectsView() const
+{
+	return Effects;
+}
+
+int32 UXeusAbilitySystemComponent::GetEffectCount() const
+{
+	return Effects.Num();
+}
+
+UXeusEffect* UXeusAbilitySystemComponent::GetEffectAt(int32 Index) const
+{
+	return Effects.IsValidIndex(Index) ? Effects[Index] : nullptr;
+}
+
+bool UXeusAbilitySystemComponent::HasMatchingGameplayTag(FGameplayTag Tag) const
+{
+	return GrantedTagCounts.Contains(Tag);
+}
+
+bool UXeusAbilitySystemComponent::HasAnyMatchingGameplayTags(const FGameplayTagContainer& Tags) const
+{
+	for (const FGameplayTag& tag : Tags)
+		if (GrantedTagCounts.Contains(tag))
+			return true;
+	return false;
+}
+
+bool UXeusAbilitySystemComponent::HasAllMatchingGameplayTags(const FGameplayTagContainer& Tags) const
+{
+	for (const FGameplayTag& tag : Tags)
+		if (!GrantedTagCounts.Contains(tag))
+			return false;
+	return true;
+}
+
+int32 UXeusAbilitySystemComponent::GetGameplayTagCount(FGameplayTag Tag) const
+{
+	const int32* count = GrantedTagCounts.Find(Tag);
+	return count ? *count : 0;
+}
+
+TArray<UXeusEffect*> UXeusAbilitySystemComponent::GetEffectsWithTag(FGameplayTag Tag) const
+{
+	const TArray<UXeusEffect*>* effects = EffectsByTag.Find(Tag);
+	return effects ? *effects : TArray<UXeusEffect*>();
+}
+
+int32 UXeusAbilitySystemComponent::StopAllEffectsWithTag(FGameplayTag Tag)
+{
+	const TArray<UXeusEffect*>* found = EffectsByTag.Find(Tag);
+	if (!found)
+		return 0;
+
+	// Copy, effects are removed from index while stopping
+	const TArray<UXeusEffect*> effects = *found;
+	int32 stopped = 0;
+	for (UXeusEffect* effect : effects)
+		if (StopEffectInstance(effect))
+			++stopped;
+	return stopped;
+}
+
+TArray<UXeusEffect*> UXeusAbilitySystemComponent::GetEffectsByInstigator(AActor* Instigator) const
+{
+	const TArray<UXeusEffect*>* effects = Instigator ? EffectsByInstigator.Find(FObjectKey(Instigator)) : nullptr;
+	return effects ? *effects : TArray<UXeusEffect*>();
+}
+
+int32 UXeusAbilitySystemComponent::StopAllEffectsByInstigator(AActor* Instigator)
+{
+	return Instigator ? StopAllEffectsByInstigatorKey(FObjectKey(Instigator)) : 0;
+}
+
+int32 UXeusAbilitySystemComponent::StopAllEffectsByInstigatorKey(FObjectKey InstigatorKey)
+{
+	const TArray<UXeusEffect*>* found = InstigatorKey != FObjectKey() ? EffectsByInstigator.Find(InstigatorKey) : nullptr;
+	if (!found)
+		return 0;
+
+	// Copy, effects are removed from index while stopping
+	const TArray<UXeusEffect*> effects = *found;
+	int32 stopped = 0;
+	for (UXeusEffect* effect : effects)
+		if (StopEffectInstance(effect))
+			++stopped;
+	return stopped;
+}
+
+bool UXeusAbilitySystemComponent::IsEffectBlocked(TSubclassOf<UXeusEffect> InClass) const
+{
+	if (!InClass || BlockedTagCounts.Num() == 0)
+		return false;
+
+	// Blocking parent tag blocks all its children
+	const UXeusEffect* effect = GetDefault<UXeusEffect>(InClass);
+	for (const FGameplayTag& tag : effect->GetGrantedTagsWithParents())
+		if (BlockedTagCounts.Contains(tag))
+			return true;
+	return false;
+}
+
 
 #pragma endregion
 
@@ -248,6 +2080,26 @@ TArray<UXeusAttribute*> UXeusAbilitySystemComponent::GetAttributes() const
 	return Attributes;
 }
 
+const TArray<UXeusAttribute*>& UXeusAbilitySystemComponent::GetAttributesRef() const
+{
+	return Attributes;
+}
+
+TArrayView<UXeusAttribute* const> UXeusAbilitySystemComponent::GetAttributesView() const
+{
+	return Attributes;
+}
+
+int32 UXeusAbilitySystemComponent::GetAttributeCount() const
+{
+	return Attributes.Num();
+}
+
+UXeusAttribute* UXeusAbilitySystemComponent::GetAttributeAt(int32 Index) const
+{
+	return Attributes.IsValidIndex(Index) ? Attributes[Index] : nullptr;
+}
+
 void UXeusAbilitySystemComponent::BP_AddAttribute(TSubclassOf<UXeusAttribute> InClass, bool& bSuccess,
                                                   UXeusAttribute*& Attribute)
 {
@@ -264,14 +2116,37 @@ UXeusAttribute* UXeusAbilitySystemComponent::AddAttributeImpl(TSubclassOf<UXeusA
 	if (Result == nullptr)
 		return nullptr;
 
+	if (AttributeSet)
+		Result->InitFromDefinition(AttributeSet);
+
 	Result->OnMinValue.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MinHandle);
 	Result->OnMaxValue.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MaxHandle);
 	Result->OnValueChanged.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::ValueChangedHandle);
-	Result->OnMinValueChanged.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MaxValueChangedHandle);
-	Result->OnMaxValueChanged.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MinValueChangedHandle);
+	Result->OnMinValueChanged.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MinValueChangedHandle);
+	Result->OnMaxValueChanged.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MaxValueChangedHandle);
+	Result->OnMultAdded.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MultChangedHandle);
+	Result->OnMultChanged.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MultChangedHandle);
+	Result->OnMultRemoved.AddUniqueDynamic(this, &UXeusAbilitySystemComponent::MultRemovedHandle);
 
 	const int32 index = Attributes.AddUnique(Result);
+	MarkStateChanged();
+
+	for (auto& pair : ModifierAggregates)
+	{
+		if (pair.Value.Attribute == nullptr && Result->IsA(pair.Key))
+		{
+			pair.Value.Attribute = Result;
+			for (const auto& link : pair.Value.Links)
+				UpdateModifierAggregate(pair.Value, link.Value);
+		}
+	}
 
+	if (bAttributesInitialized)
+		RebuildDependencyGraph();
+
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAttributeChanged(this, Result);
+	OnAttributeAdded.Broadcast(this, Result);
 	return Result;
 }
 
@@ -281,11 +2156,23 @@ bool UXeusAbilitySystemComponent::RemoveAttribute(TSubclassOf<UXeusAttribute> In
 	if (!Attribute)
 		return false;
 
+	OnAttributeRemoved.Broadcast(this, Attribute);
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAttributeRemoved(this, Attribute);
+
+	for (auto& pair : ModifierAggregates)
+		if (pair.Value.Attribute == Attribute)
+			pair.Value.Attribute = nullptr;
+	MarkStateChanged();
+
 	const int32 index = Attributes.Find(Attribute);
 	Attributes[index]->ConditionalBeginDestroy();
 	Attributes[index] = nullptr;
 	Attributes.RemoveAt(index);
 
+	if (bAttributesInitialized)
+		RebuildDependencyGraph();
+
 	return true;
 }
 
@@ -300,34 +2187,160 @@ void UXeusAbilitySystemComponent::RemoveAllAttributes()
 		}
 	}
 	Attributes.Empty();
+
+	for (auto& pair : ModifierAggregates)
+		pair.Value.Attribute = nullptr;
+
+	RebuildDependencyGraph();
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAllAttributesRemoved(this);
+	MarkStateChanged();
+	OnStateReset.Broadcast(this);
 }
 
 void UXeusAbilitySystemComponent::RemoveAllEffects()
 {
+	RemoveAllEffectsImpl(true);
+}
+
+void UXeusAbilitySystemComponent::RemoveAllEffectsImpl(bool bFireEndEvents)
+{
+	// Listeners are notified like on removal of each effect, but effects do not run EndWork
+	if (bFireEndEvents)
+	{
+		const TArray<UXeusEffect*> removed = Effects;
+		for (UXeusEffect* effect : removed)
+		{
+			if (!effect || !Effects.Contains(effect))
+				continue;
+			for (int32 i = 0; i < Effects.Num(); ++i)
+				if (Effects[i] && Effects[i] != effect)
+					Effects[i]->EffectRemoving(effect);
+			OnEffectEndWork.Broadcast(this, effect);
+		}
+	}
+
 	for (int32 i = 0; i < Effects.Num(); ++i)
 	{
 		if (Effects[i])
 		{
-			Effects[i]->ConditionalBeginDestroy();
+			ReleaseEffectHandle(Effects[i]);
+			DestroyEffectInstance(Effects[i]);
 			Effects[i] = nullptr;
 		}
 	}
 	Effects.Empty();
+	ModifierAggregates.Empty();
+	StackableEffects.Empty();
+	GrantedTagCounts.Empty();
+	BlockedTagCounts.Empty();
+	EffectsByTag.Empty();
+	EffectsByInstigator.Empty();
+	EffectTimers.Empty();
+	EffectTimerQueue.Empty();
+	ResetRollbackHistory();
+
+	// Icons stay cached, but no effect uses them now
+	ReleaseAllIcons();
+
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAllEffectsRemoved(this);
+	MarkStateChanged();
+	OnStateReset.Broadcast(this);
+}
+
+
+UXeusAbilitySystemViewModel* UXeusAbilitySystemComponent::GetViewModel()
+{
+	if (ViewModel == nullptr)
+	{
+		ViewModel = NewObject<UXeusAbilitySystemViewModel>(this);
+		ViewModel->Bind(this);
+	}
+	return ViewModel;
+}
+
+UXeusEffectIconSubsystem* UXeusAbilitySystemComponent::GetIconSubsystem()
+{
+	if (IconSubsystem == nullptr)
+	{
+		UWorld* world = GetWorld();
+		IconSubsystem = world ? world->GetSubsystem<UXeusEffectIconSubsystem>() : nullptr;
+	}
+	return IconSubsystem;
+}
+
+void UXeusAbilitySystemComponent::AcquireEffectIcon(UXeusEffect* InEffect)
+{
+	if (!bPrefetchIcons || !InEffect->GetIsDisplayable() || EffectIcons.Contains(InEffect))
+		return;
+
+	// Icon of instance is requested, the subsystem measures and releases the same path
+	const FSoftObjectPath icon = InEffect->GetIcon().ToSoftObjectPath();
+	UXeusEffectIconSubsystem* icons = icon.IsNull() ? nullptr : GetIconSubsystem();
+	if (!icons)
+		return;
+
+	icons->AcquireIcon(icon);
+	EffectIcons.Add(InEffect, icon);
+}
+
+void UXeusAbilitySystemComponent::ReleaseEffectIcon(UXeusEffect* InEffect)
+{
+	FSoftObjectPath icon;
+	if (!EffectIcons.RemoveAndCopyValue(InEffect, icon))
+		return;
+
+	if (UXeusEffectIconSubsystem* icons = GetIconSubsystem())
+		icons->ReleaseIcon(icon);
+}
+
+void UXeusAbilitySystemComponent::ReleaseAllIcons()
+{
+	if (UXeusEffectIconSubsystem* icons = EffectIcons.Num() > 0 ? GetIconSubsystem() : nullptr)
+		for (const auto& pair : EffectIcons)
+			icons->ReleaseIcon(pair.Value);
+	EffectIcons.Empty();
+}
+
+bool UXeusAbilitySystemComponent::IsEffectIconLoaded(TSubclassOf<UXeusEffect> InClass) const
+{
+	const UWorld* world = GetWorld();
+	const UXeusEffectIconSubsystem* icons = world ? world->GetSubsystem<UXeusEffectIconSubsystem>() : nullptr;
+	return icons && InClass && icons->IsIconLoaded(InClass.GetDefaultObject()->GetIcon());
 }
 
+float UXeusAbilitySystemComponent::GetIconCacheSizeMB() const
+{
+	const UWorld* world = GetWorld();
+	const UXeusEffectIconSubsystem* icons = world ? world->GetSubsystem<UXeusEffectIconSubsystem>() : nullptr;
+	return icons ? icons->GetCacheSizeMB() : 0.0f;
+}
 
 void UXeusAbilitySystemComponent::ValueChangedHandle(UXeusAttribute* Attribute, float Value)
 {
+	MarkStateChanged();
+	MarkDependentsDirty(Attribute);
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAttributeChanged(this, Attribute);
 	OnValueChanged.Broadcast(this, Attribute, Value);
 }
 
 void UXeusAbilitySystemComponent::MinValueChangedHandle(UXeusAttribute* Attribute, float Value)
 {
+	MarkStateChanged();
+	MarkDependentsDirty(Attribute);
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAttributeChanged(this, Attribute);
 	OnMinValueChanged.Broadcast(this, Attribute, Value);
 }
 
 void UXeusAbilitySystemComponent::MaxValueChangedHandle(UXeusAttribute* Attribute, float Value)
 {
+	MarkStateChanged();
+	MarkDependentsDirty(Attribute);
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAttributeChanged(this, Attribute);
 	OnMaxValueChanged.Broadcast(this, Attribute, Value);
 }
 
@@ -341,4 +2354,221 @@ void UXeusAbilitySystemComponent::MinHandle(UXeusAttribute* Attribute)
 	OnMinValue.Broadcast(this, Attribute);;
 }
 
+void UXeusAbilitySystemComponent::MultChangedHandle(UXeusAttribute* Attribute, FName UniqueId)
+{
+	MarkStateChanged();
+	MarkDependentsDirty(Attribute);
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAttributeChanged(this, Attribute);
+}
+
+void UXeusAbilitySystemComponent::MultRemovedHandle(UXeusAttribute* Attribute)
+{
+	MarkStateChanged();
+	MarkDependentsDirty(Attribute);
+	if (QuerySubsystem)
+		QuerySubsystem->NotifyAttributeChanged(this, Attribute);
+}
+
+void UXeusAbilitySystemComponent::RebuildDependencyGraph()
+{
+	DerivedOrder.Reset();
+	DerivedInputs.Reset();
+	DerivedDependents.Reset();
+
+	// Collect derived attributes and edges between them
+	TArray<UXeusDerivedAttribute*> derived;
+	for (UXeusAttribute* attribute : Attributes)
+		if (UXeusDerivedAttribute* derivedAttribute = Cast<UXeusDerivedAttribute>(attribute))
+			derived.Add(derivedAttribute);
+
+	TArray<TArray<UXeusAttribute*>> inputs;
+	TArray<int32> inDegree;
+	TMap<UXeusAttribute*, TArray<int32>> dependents;
+	inputs.SetNum(derived.Num());
+	inDegree.SetNumZeroed(derived.Num());
+
+	for (int32 i = 0; i < derived.Num(); ++i)
+	{
+		for (const FXeusDerivedAttributeTerm& term : derived[i]->GetTerms())
+		{
+			UXeusAttribute* input = term.Source ? GetAttributeByClass(term.Source) : nullptr;
+			inputs[i].Add(input);
+			if (input == nullptr)
+				continue;
+
+			TArray<int32>& inputDependents = dependents.FindOrAdd(input);
+			if (inputDependents.Contains(i))
+				continue;
+			inputDependents.Add(i);
+			if (input->IsA<UXeusDerivedAttribute>())
+				++inDegree[i];
+		}
+	}
+
+	// Kahn's topological sort
+	TArray<int32> sorted;
+	sorted.Reserve(derived.Num());
+	for (int32 i = 0; i < derived.Num(); ++i)
+		if (inDegree[i] == 0)
+			sorted.Add(i);
+
+	for (int32 head = 0; head < sorted.Num(); ++head)
+	{
+		if (const TArray<int32>* next = dependents.Find(derived[sorted[head]]))
+			for (const int32 dependent : *next)
+				if (--inDegree[dependent] == 0)
+					sorted.Add(dependent);
+	}
+
+	if (sorted.Num() != derived.Num())
+	{
+		for (int32 i = 0; i < derived.Num(); ++i)
+		{
+			if (inDegree[i] > 0)
+			{
+				UE_LOG(AbilitySystemLog, Error, TEXT("%s: derived attribute %s is part of dependency cycle and will not be updated"),
+				       *GetNameSafe(GetOwner()), *derived[i]->GetClass()->GetName());
+			}
+		}
+	}
+
+	// Remap indices to sorted order
+	TArray<int32> sortedIndex;
+	sortedIndex.Init(INDEX_NONE, derived.Num());
+	for (int32 i = 0; i < sorted.Num(); ++i)
+	{
+		sortedIndex[sorted[i]] = i;
+		DerivedOrder.Add(derived[sorted[i]]);
+		DerivedInputs.Add(MoveTemp(inputs[sorted[i]]));
+	}
+
+	for (auto& pair : dependents)
+	{
+		TArray<int32>& remapped = DerivedDependents.Add(pair.Key);
+		for (const int32 dependent : pair.Value)
+			if (sortedIndex[dependent] != INDEX_NONE)
+				remapped.Add(sortedIndex[dependent]);
+	}
+
+	// Everything must be recalculated once after rebuild
+	DirtyDerived.Init(true, DerivedOrder.Num());
+	bHasDirtyDerived = DerivedOrder.Num() > 0;
+}
+
+void UXeusAbilitySystemComponent::MarkDependentsDirty(UXeusAttribute* Attribute)
+{
+	const TArray<int32>* dependents = DerivedDependents.Find(Attribute);
+	if (!dependents)
+		return;
+
+	for (const int32 index : *dependents)
+		DirtyDerived[index] = true;
+	bHasDirtyDerived = true;
+}
+
+void UXeusAbilitySystemComponent::FlushDerivedAttributes()
+{
+	if (!bHasDirtyDerived)
+		return;
+	bHasDirtyDerived = false;
+
+	// Recalculation of one attribute marks its dependents which always go later in order
+	for (int32 index = 0; index < DerivedOrder.Num(); ++index)
+	{
+		if (DirtyDerived[index])
+		{
+			DirtyDerived[index] = false;
+			DerivedOrder[index]->Recompute(DerivedInputs[index]);
+		}
+	}
+}
+
 #pragma endregion
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Xeus.Rollback.Benchmark [Components] [Frames]
+ * Spawns isolated deterministic components (100 by default) with state of first component in world,
+ * rewinds them by Frames steps (8 by default) and resimulates them
+ */
+static void RunRollbackBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	if (!World)
+		return;
+
+	const int32 count = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100;
+	const int32 frames = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 8;
+
+	FXeusAbilitySystemSnapshot templateSnapshot;
+	bool bHasTemplate = false;
+	for (TObjectIterator<UXeusAbilitySystemComponent> it; it; ++it)
+	{
+		if (it->GetWorld() == World && it->HasBegunPlay())
+		{
+			it->CaptureSnapshotTo(templateSnapshot);
+			bHasTemplate = true;
+			break;
+		}
+	}
+
+	// Gameplay components are never stepped or rewound by benchmark
+	FActorSpawnParameters params;
+	params.ObjectFlags |= RF_Transient;
+	TArray<AActor*> actors;
+	TArray<UXeusAbilitySystemComponent*> components;
+	actors.Reserve(count);
+	components.Reserve(count);
+	for (int32 i = 0; i < count; ++i)
+	{
+		AActor* actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, params);
+		if (!actor)
+			continue;
+
+		UXeusAbilitySystemComponent* component = NewObject<UXeusAbilitySystemComponent>(actor);
+		component->RegisterComponent();
+		if (bHasTemplate)
+			component->RestoreSnapshot(templateSnapshot);
+		component->SetDeterministic(true, frames, false);
+		actors.Add(actor);
+		components.Add(component);
+	}
+
+	if (components.Num() == 0)
+	{
+		UE_LOG(AbilitySystemLog, Warning, TEXT("Rollback benchmark could not spawn components"));
+		return;
+	}
+
+	// Fill history
+	for (UXeusAbilitySystemComponent* component : components)
+		component->AdvanceFixedStep(frames);
+
+	int32 rewound = 0;
+	double start = FPlatformTime::Seconds();
+	for (UXeusAbilitySystemComponent* component : components)
+		if (component->RewindTo(component->GetStepIndex() - frames))
+			++rewound;
+	const double rewindTime = FPlatformTime::Seconds() - start;
+
+	start = FPlatformTime::Seconds();
+	for (UXeusAbilitySystemComponent* component : components)
+		component->ResimulateTo(component->GetStepIndex() + frames);
+	const double resimulateTime = FPlatformTime::Seconds() - start;
+
+	for (AActor* actor : actors)
+		actor->Destroy();
+
+	UE_LOG(AbilitySystemLog, Display,
+	       TEXT("Rollback benchmark: %d components (%d rewound, %s), %d frames, rewind %.3f ms, resimulate %.3f ms"),
+	       components.Num(), rewound, bHasTemplate ? TEXT("seeded") : TEXT("empty"), frames,
+	       rewindTime * 1000.0, resimulateTime * 1000.0);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GRollbackBenchmarkCommand(
+	TEXT("Xeus.Rollback.Benchmark"),
+	TEXT("Spawn N deterministic components (default 100), rewind and resimulate them by M frames (default 8)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunRollbackBenchmark));
+
+#endif
@@ -0,0 +1,79 @@
+﻿// Developed by OIC
+
+
+#include "Data/Attributes/XeusDerivedAttribute.h"
+
+FXeusDerivedAttributeTerm::FXeusDerivedAttributeTerm()
+	: Source(nullptr)
+	  , Input(EXeusDerivedAttributeInput::Value)
+	  , Coefficient(1.0f)
+{
+}
+
+UXeusDerivedAttribute::UXeusDerivedAttribute(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	Target = EXeusDerivedAttributeTarget::Value;
+	BaseValue = 0.0f;
+}
+
+float UXeusDerivedAttribute::ComputeDerivedValue_Implementation(const TArray<UXeusAttribute*>& Inputs) const
+{
+	float Value = BaseValue;
+	for (int32 i = 0; i < Terms.Num() && i < Inputs.Num(); ++i)
+	{
+		if (Inputs[i])
+		{
+			Value += Terms[i].Coefficient * GetInputValue(Inputs[i], Terms[i].Input);
+		}
+	}
+	return Value;
+}
+
+const TArray<FXeusDerivedAttributeTerm>& UXeusDerivedAttribute::GetTerms() const
+{
+	return Terms;
+}
+
+EXeusDerivedAttributeTarget UXeusDerivedAttribute::GetTarget() const
+{
+	return Target;
+}
+
+void UXeusDerivedAttribute::Recompute(const TArray<UXeusAttribute*>& Inputs)
+{
+	const float Value = ComputeDerivedValue(Inputs);
+	switch (Target)
+	{
+	default:
+		break;
+	case EXeusDerivedAttributeTarget::Value:
+		if (FMath::Clamp(Value, GetMinValue(), GetMaxValue()) != CurrentValue)
+			SetCurrentValue(Value);
+		break;
+	case EXeusDerivedAttributeTarget::MaxValue:
+		if (Value != MaxValue)
+			SetMaxValue(Value);
+		break;
+	case EXeusDerivedAttributeTarget::MinValue:
+		if (Value != MinValue)
+			SetMinValue(Value);
+		break;
+	}
+}
+
+float UXeusDerivedAttribute::GetInputValue(const UXeusAttribute* Attribute, EXeusDerivedAttributeInput Input)
+{
+	switch (Input)
+	{
+	default:
+	case EXeusDerivedAttributeInput::Value:
+		return Attribute->GetCurrentValue();
+	case EXeusDerivedAttributeInput::MaxValue:
+		return Attribute->GetMaxValue();
+	case EXeusDerivedAttributeInput::MinValue:
+		return Attribute->GetMinValue();
+	case EXeusDerivedAttributeInput::Percent:
+		return Attribute->GetPercent();
+	}
+}
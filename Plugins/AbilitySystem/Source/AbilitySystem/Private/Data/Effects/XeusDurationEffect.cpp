@@ -0,0 +1,149 @@
+﻿// Developed by OIC
+
+#include "Data/Effects/XeusDurationEffect.h"
+
+UXeusDurationEffect::UXeusDurationEffect(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	Duration = 10.0f;
+	StartTime = 0.0;
+	PausedTime = 0.0;
+	PauseStartTime = 0.0;
+	bPaused = false;
+}
+
+void UXeusDurationEffect::ScheduleExpire()
+{
+	ClearEffectTimer(ExpireTimerHandle);
+	ExpireTimerHandle = SetEffectTimer(FSimpleDelegate::CreateUObject(this, &UXeusDurationEffect::Expired),
+	                                   GetRemainingTime(), false);
+}
+
+void UXeusDurationEffect::ClearExpire()
+{
+	ClearEffectTimer(ExpireTimerHandle);
+}
+
+void UXeusDurationEffect::Expired_Implementation()
+{
+	EndWork();
+}
+
+void UXeusDurationEffect::Work_Implementation()
+{
+	StartTime = GetEffectTime();
+	PausedTime = 0.0;
+	bPaused = false;
+	ScheduleExpire();
+}
+
+void UXeusDurationEffect::EndWork_Implementation()
+{
+	ClearExpire();
+	Super::EndWork_Implementation();
+}
+
+void UXeusDurationEffect::RefreshDuration()
+{
+	StartTime = GetEffectTime();
+	PausedTime = 0.0;
+	PauseStartTime = StartTime;
+	if (!bPaused)
+		ScheduleExpire();
+	OnDurationChanged.Broadcast(this, Duration);
+}
+
+void UXeusDurationEffect::ExtendDuration()
+{
+	SetDuration(Duration + GetClass()->GetDefaultObject<UXeusDurationEffect>()->Duration);
+}
+
+void UXeusDurationEffect::RestoreWork()
+{
+	if (!bPaused)
+		ScheduleExpire();
+}
+
+void UXeusDurationEffect::ResetState_Implementation()
+{
+	ClearEffectTimer(ExpireTimerHandle);
+	Duration = GetClass()->GetDefaultObject<UXeusDurationEffect>()->Duration;
+	StartTime = 0.0;
+	PausedTime = 0.0;
+	PauseStartTime = 0.0;
+	bPaused = false;
+	OnDurationChanged.Clear();
+	OnPausedChanged.Clear();
+	Super::ResetState_Implementation();
+}
+
+void UXeusDurationEffect::Setup(const FXeusEffectSettings& Settings)
+{
+	Super::Setup(Settings);
+	if (Settings.bOverrideDuration)
+		Duration = FMath::Max(Settings.Duration, 0.001f);
+}
+
+void UXeusDurationEffect::SerializeState(FArchive& Ar)
+{
+	Super::SerializeState(Ar);
+	Ar << Duration;
+	Ar << StartTime;
+	Ar << PausedTime;
+	Ar << PauseStartTime;
+	Ar << bPaused;
+}
+
+void UXeusDurationEffect::SetDuration(float Value)
+{
+	Duration = FMath::Max(Value, 0.001f);
+	if (!bPaused && ExpireTimerHandle.IsValid())
+		ScheduleExpire();
+	OnDurationChanged.Broadcast(this, Duration);
+}
+
+void UXeusDurationEffect::SetPaused(bool Value)
+{
+	if (bPaused == Value)
+		return;
+
+	if (Value)
+	{
+		PauseStartTime = GetEffectTime();
+		bPaused = true;
+		ClearExpire();
+	}
+	else
+	{
+		PausedTime += GetEffectTime() - PauseStartTime;
+		bPaused = false;
+		ScheduleExpire();
+	}
+	OnPausedChanged.Broadcast(this, bPaused);
+}
+
+float UXeusDurationEffect::GetDuration() const
+{
+	return Duration;
+}
+
+float UXeusDurationEffect::GetElapsedTime() const
+{
+	const double now = bPaused ? PauseStartTime : GetEffectTime();
+	return FMath::Clamp(static_cast<float>(now - StartTime - PausedTime), 0.0f, Duration);
+}
+
+float UXeusDurationEffect::GetRemainingTime() const
+{
+	return Duration - GetElapsedTime();
+}
+
+float UXeusDurationEffect::GetPercent() const
+{
+	return GetElapsedTime() / Duration;
+}
+
+bool UXeusDurationEffect::GetIsPaused() const
+{
+	return bPaused;
+}
@@ -3,11 +3,19 @@
 
 #include "Data/Effects/XeusPereodicEffect.h"
 
+#include "Components/XeusAbilitySystemComponent.h"
+
 UXeusPereodicEffect::UXeusPereodicEffect(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	Rate = 1.0f;
 	Value = 1.0f;
+	bCatchUp = false;
+	bCollapseTicks = false;
+	StartTime = 0.0;
+	TicksFired = 0;
+	EmittedOutput = 0;
+	NextTickRemaining = 0.0f;
 }
 
 void UXeusPereodicEffect::PeriodTick_Implementation()
@@ -15,13 +23,128 @@ void UXeusPereodicEffect::PeriodTick_Implementation()
 	// Tick here
 }
 
+void UXeusPereodicEffect::PeriodTicks_Implementation(int32 Count, float Amount)
+{
+	for (int32 i = 0; i < Count; ++i)
+		PeriodTick();
+}
+
 void UXeusPereodicEffect::Work_Implementation()
 {
-	GetWorld()->GetTimerManager().SetTimer(TimerHandle, this, &UXeusPereodicEffect::PeriodTick, Rate, true);
+	StartTime = GetEffectTime();
+	TicksFired = 0;
+	EmittedOutput = 0;
+	ClearEffectTimer(TimerHandle);
+	TimerHandle = SetEffectTimer(FSimpleDelegate::CreateUObject(this, &UXeusPereodicEffect::TimerTick), Rate, true);
 }
 
 void UXeusPereodicEffect::EndWork_Implementation()
 {
-	GetWorld()->GetTimerManager().ClearTimer(TimerHandle);
+	// Periods that are already over should not be lost if effect is stopped before timer callback
+	if (bCatchUp && TimerHandle.IsValid())
+	{
+		FireDueTicks();
+		// One of the ticks already ended the effect
+		if (!IsEffectActive())
+			return;
+	}
+
+	ClearEffectTimer(TimerHandle);
 	Super::EndWork_Implementation();
 }
+
+void UXeusPereodicEffect::TimerTick()
+{
+	if (bCatchUp)
+	{
+		FireDueTicks();
+		return;
+	}
+
+	++TicksFired;
+	EmittedOutput += FMath::RoundToInt(Value * FixedPointScale);
+	PeriodTick();
+}
+
+void UXeusPereodicEffect::FireDueTicks()
+{
+	const double elapsed = GetEffectTime() - StartTime;
+	const int32 dueTicks = FMath::FloorToInt(static_cast<float>((elapsed + KINDA_SMALL_NUMBER) / Rate));
+	const int32 count = dueTicks - TicksFired;
+	if (count <= 0)
+		return;
+
+	// Output is derived from total ticks, so it is the same however ticks are grouped
+	TicksFired = dueTicks;
+	const int64 targetOutput = static_cast<int64>(TicksFired) * FMath::RoundToInt(Value * FixedPointScale);
+	const float amount = static_cast<float>(targetOutput - EmittedOutput) / FixedPointScale;
+	EmittedOutput = targetOutput;
+
+	if (bCollapseTicks)
+	{
+		PeriodTicks(count, amount);
+	}
+	else
+	{
+		// Tick can end the effect, remaining ticks must not run on removed instance
+		for (int32 i = 0; i < count && IsEffectActive(); ++i)
+			PeriodTick();
+	}
+}
+
+void UXeusPereodicEffect::RestoreWork()
+{
+	ClearEffectTimer(TimerHandle);
+	TimerHandle = SetEffectTimer(FSimpleDelegate::CreateUObject(this, &UXeusPereodicEffect::TimerTick),
+	                             NextTickRemaining, true, Rate);
+}
+
+void UXeusPereodicEffect::ResetState_Implementation()
+{
+	ClearEffectTimer(TimerHandle);
+	const UXeusPereodicEffect* defaults = GetClass()->GetDefaultObject<UXeusPereodicEffect>();
+	Rate = defaults->Rate;
+	Value = defaults->Value;
+	StartTime = 0.0;
+	TicksFired = 0;
+	EmittedOutput = 0;
+	NextTickRemaining = 0.0f;
+	Super::ResetState_Implementation();
+}
+
+void UXeusPereodicEffect::Setup(const FXeusEffectSettings& Settings)
+{
+	Super::Setup(Settings);
+	if (Settings.bOverrideMagnitude)
+		Value = Settings.Magnitude;
+	if (Settings.bOverridePeriod)
+		Rate = FMath::Max(Settings.Period, 0.001f);
+}
+
+void UXeusPereodicEffect::SerializeState(FArchive& Ar)
+{
+	Super::SerializeState(Ar);
+
+	if (Ar.IsSaving())
+	{
+		const float remaining = AbilitySystem ? AbilitySystem->GetEffectTimerRemaining(TimerHandle) : -1.0f;
+		NextTickRemaining = remaining >= 0.0f ? remaining : Rate;
+	}
+
+	Ar << Rate;
+	Ar << Value;
+	Ar << StartTime;
+	Ar << TicksFired;
+	Ar << EmittedOutput;
+	Ar << NextTickRemaining;
+}
+
+int32 UXeusPereodicEffect::GetTicksFired() const
+{
+	return TicksFired;
+}
+
+float UXeusPereodicEffect::GetTotalOutput() const
+{
+	return static_cast<float>(EmittedOutput) / FixedPointScale;
+}
@@ -2,6 +2,7 @@
 
 #include "Data/Effects/XeusProgressEffect.h"
 
+#include "Components/XeusAbilitySystemComponent.h"
 #include "Net/UnrealNetwork.h"
 
 UXeusProgressEffect::UXeusProgressEffect(const FObjectInitializer& ObjectInitializer)
@@ -13,35 +14,31 @@ UXeusProgressEffect::UXeusProgressEffect(const FObjectInitializer& ObjectInitial
 	ProgressAmount = 1.0f;
 	bInProgress = false;
 	bStackable = false;
+	NextTickRemaining = 0.0f;
 }
 
 void UXeusProgressEffect::StartTimer()
 {
-	FTimerManager& manager = GetWorld()->GetTimerManager();
-	if (manager.TimerExists(ProgressTimerHandle))
-		manager.ClearTimer(ProgressTimerHandle);
-	
-	manager.SetTimer(ProgressTimerHandle,
-	                 this, &UXeusProgressEffect::TimerWork, ProgressRate, true);
+	ClearEffectTimer(ProgressTimerHandle);
+	ProgressTimerHandle = SetEffectTimer(FSimpleDelegate::CreateUObject(this, &UXeusProgressEffect::TimerWork),
+	                                     ProgressRate, true);
 }
 
 // ReSharper disable once CppMemberFunctionMayBeConst
 void UXeusProgressEffect::PauseTimer()
 {
-	auto& manager = GetWorld()->GetTimerManager();
-	if (manager.IsTimerActive(ProgressTimerHandle))
+	if (AbilitySystem && AbilitySystem->IsEffectTimerActive(ProgressTimerHandle))
 	{
-		manager.PauseTimer(ProgressTimerHandle);
+		AbilitySystem->PauseEffectTimer(ProgressTimerHandle);
 	}
 }
 
 // ReSharper disable once CppMemberFunctionMayBeConst
 void UXeusProgressEffect::UnPauseTimer()
 {
-	auto& manager = GetWorld()->GetTimerManager();
-	if (manager.IsTimerPaused(ProgressTimerHandle))
+	if (AbilitySystem && AbilitySystem->IsEffectTimerPaused(ProgressTimerHandle))
 	{
-		manager.UnPauseTimer(ProgressTimerHandle);
+		AbilitySystem->UnPauseEffectTimer(ProgressTimerHandle);
 	}
 }
 
@@ -58,6 +55,79 @@ void UXeusProgressEffect::Work_Implementation()
 	StartTimer();
 }
 
+void UXeusProgressEffect::EndWork_Implementation()
+{
+	ClearEffectTimer(ProgressTimerHandle);
+	Super::EndWork_Implementation();
+}
+
+void UXeusProgressEffect::RefreshDuration()
+{
+	SetCurrentProgress(0.0f);
+}
+
+void UXeusProgressEffect::ExtendDuration()
+{
+	SetNeedProgress(NeedProgress + GetClass()->GetDefaultObject<UXeusProgressEffect>()->NeedProgress);
+}
+
+void UXeusProgressEffect::RestoreWork()
+{
+	ClearEffectTimer(ProgressTimerHandle);
+	ProgressTimerHandle = SetEffectTimer(FSimpleDelegate::CreateUObject(this, &UXeusProgressEffect::TimerWork),
+	                                     NextTickRemaining, true, ProgressRate);
+	if (!bInProgress)
+		PauseTimer();
+}
+
+void UXeusProgressEffect::ResetState_Implementation()
+{
+	ClearEffectTimer(ProgressTimerHandle);
+	const UXeusProgressEffect* defaults = GetClass()->GetDefaultObject<UXeusProgressEffect>();
+	CurrentProgress = defaults->CurrentProgress;
+	NeedProgress = defaults->NeedProgress;
+	ProgressRate = defaults->ProgressRate;
+	ProgressAmount = defaults->ProgressAmount;
+	bInProgress = false;
+	NextTickRemaining = 0.0f;
+	OnCurrentProgressChanged.Clear();
+	OnNeedProgressChanged.Clear();
+	OnProgressRateChanged.Clear();
+	OnProgressAmountChanged.Clear();
+	OnInProgressChanged.Clear();
+	Super::ResetState_Implementation();
+}
+
+void UXeusProgressEffect::Setup(const FXeusEffectSettings& Settings)
+{
+	Super::Setup(Settings);
+	if (Settings.bOverrideMagnitude)
+		ProgressAmount = FMath::Max(Settings.Magnitude, 0.001f);
+	// Duration is progress target here, keep ClampMin of NeedProgress
+	if (Settings.bOverrideDuration)
+		NeedProgress = FMath::Max(Settings.Duration, 1.0f);
+	if (Settings.bOverridePeriod)
+		ProgressRate = FMath::Max(Settings.Period, 0.001f);
+}
+
+void UXeusProgressEffect::SerializeState(FArchive& Ar)
+{
+	Super::SerializeState(Ar);
+
+	if (Ar.IsSaving())
+	{
+		const float remaining = AbilitySystem ? AbilitySystem->GetEffectTimerRemaining(ProgressTimerHandle) : -1.0f;
+		NextTickRemaining = remaining >= 0.0f ? remaining : ProgressRate;
+	}
+
+	Ar << CurrentProgress;
+	Ar << NeedProgress;
+	Ar << ProgressRate;
+	Ar << ProgressAmount;
+	Ar << bInProgress;
+	Ar << NextTickRemaining;
+}
+
 void UXeusProgressEffect::SetCurrentProgress(float Value)
 {
 	this->CurrentProgress = FMath::Clamp(Value, 0.0f, NeedProgress);
@@ -0,0 +1,295 @@
+﻿// Developed by OIC
+
+#include "Data/XeusAbilitySystemViewModel.h"
+
+#include "Components/XeusAbilitySystemComponent.h"
+
+UXeusAbilitySystemViewModel::UXeusAbilitySystemViewModel()
+{
+	AbilitySystem = nullptr;
+	bEffectRowsChanged = false;
+}
+
+void UXeusAbilitySystemViewModel::Bind(UXeusAbilitySystemComponent* InAbilitySystem)
+{
+	if (AbilitySystem)
+	{
+		AbilitySystem->OnValueChanged.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_ValueChanged);
+		AbilitySystem->OnMaxValueChanged.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_ValueChanged);
+		AbilitySystem->OnMinValueChanged.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_ValueChanged);
+		AbilitySystem->OnAttributeAdded.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_AttributeAdded);
+		AbilitySystem->OnAttributeRemoved.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_AttributeRemoved);
+		AbilitySystem->OnEffectStartedWork.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_EffectStarted);
+		AbilitySystem->OnEffectEndWork.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_EffectEnded);
+		AbilitySystem->OnEffectUnlinked.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_EffectEnded);
+		AbilitySystem->OnStateReset.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Component_StateReset);
+	}
+
+	AbilitySystem = InAbilitySystem;
+
+	if (AbilitySystem)
+	{
+		AbilitySystem->OnValueChanged.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_ValueChanged);
+		AbilitySystem->OnMaxValueChanged.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_ValueChanged);
+		AbilitySystem->OnMinValueChanged.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_ValueChanged);
+		AbilitySystem->OnAttributeAdded.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_AttributeAdded);
+		AbilitySystem->OnAttributeRemoved.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_AttributeRemoved);
+		AbilitySystem->OnEffectStartedWork.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_EffectStarted);
+		AbilitySystem->OnEffectEndWork.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_EffectEnded);
+		AbilitySystem->OnEffectUnlinked.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_EffectEnded);
+		AbilitySystem->OnStateReset.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Component_StateReset);
+	}
+
+	Rebuild();
+}
+
+FEffectData UXeusAbilitySystemViewModel::MakeEffectRow(UXeusEffect* Effect)
+{
+	const FXeusClassDisplayName& name = Effect->GetClassDisplayName();
+	return {Effect, name.Name, name.Text, name.Id};
+}
+
+void UXeusAbilitySystemViewModel::Rebuild()
+{
+	for (const FAttributeData& row : AttributeRows)
+		if (row.Ref)
+			BindAttribute(row.Ref, false);
+	AttributeRows.Reset();
+	AttributeIndices.Reset();
+	DirtyAttributeRows.Reset();
+	DirtyAttributeFlags.Reset();
+
+	if (AbilitySystem)
+	{
+		for (UXeusAttribute* attribute : AbilitySystem->GetAttributesRef())
+			if (attribute)
+				AddAttributeRow(attribute);
+	}
+
+	// Every row is new for widgets
+	for (int32 i = 0; i < AttributeRows.Num(); ++i)
+		MarkAttributeRowDirty(i);
+	OnAttributeRowsChanged.Broadcast(this);
+
+	RebuildEffectRows();
+}
+
+void UXeusAbilitySystemViewModel::RebuildEffectRows()
+{
+	EffectRows.Reset();
+	EffectIndices.Reset();
+
+	if (AbilitySystem)
+	{
+		for (UXeusEffect* effect : AbilitySystem->GetEffectsRef())
+		{
+			if (effect)
+			{
+				EffectIndices.Add(effect, EffectRows.Num());
+				EffectRows.Add(MakeEffectRow(effect));
+			}
+		}
+	}
+
+	bEffectRowsChanged = true;
+	OnEffectRowsChanged.Broadcast(this);
+}
+
+int32 UXeusAbilitySystemViewModel::AddAttributeRow(UXeusAttribute* Attribute)
+{
+	if (const int32* index = AttributeIndices.Find(Attribute))
+		return *index;
+
+	const FXeusClassDisplayName& name = Attribute->GetClassDisplayName();
+	const int32 index = AttributeRows.Add({
+		Attribute, name.Name, Attribute->GetCurrentValue(), Attribute->GetMaxValue(), name.Text, name.Id
+	});
+	AttributeIndices.Add(Attribute, index);
+	DirtyAttributeFlags.Add(false);
+	BindAttribute(Attribute, true);
+	return index;
+}
+
+void UXeusAbilitySystemViewModel::BindAttribute(UXeusAttribute* Attribute, bool bBind)
+{
+	if (bBind)
+	{
+		Attribute->OnMultAdded.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Attribute_MultChanged);
+		Attribute->OnMultChanged.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Attribute_MultChanged);
+		Attribute->OnMultRemoved.AddUniqueDynamic(this, &UXeusAbilitySystemViewModel::Attribute_MultRemoved);
+	}
+	else
+	{
+		Attribute->OnMultAdded.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Attribute_MultChanged);
+		Attribute->OnMultChanged.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Attribute_MultChanged);
+		Attribute->OnMultRemoved.RemoveDynamic(this, &UXeusAbilitySystemViewModel::Attribute_MultRemoved);
+	}
+}
+
+void UXeusAbilitySystemViewModel::RemoveAttributeRow(UXeusAttribute* Attribute)
+{
+	int32 index = INDEX_NONE;
+	if (!AttributeIndices.RemoveAndCopyValue(Attribute, index))
+		return;
+
+	BindAttribute(Attribute, false);
+	AttributeRows.RemoveAt(index);
+	DirtyAttributeFlags.RemoveAt(index);
+	for (int32 i = index; i < AttributeRows.Num(); ++i)
+		AttributeIndices[AttributeRows[i].Ref] = i;
+
+	// Indices of dirty rows after removed one are shifted too
+	DirtyAttributeRows.Remove(index);
+	for (int32& row : DirtyAttributeRows)
+		if (row > index)
+			--row;
+
+	OnAttributeRowsChanged.Broadcast(this);
+}
+
+void UXeusAbilitySystemViewModel::UpdateAttributeRow(UXeusAttribute* Attribute, bool bForce)
+{
+	const int32* index = AttributeIndices.Find(Attribute);
+	if (!index)
+		return;
+
+	FAttributeData& row = AttributeRows[*index];
+	const float value = Attribute->GetCurrentValue();
+	const float maxValue = Attribute->GetMaxValue();
+	if (!bForce && row.Value == value && row.MaxValue == maxValue)
+		return;
+
+	row.Value = value;
+	row.MaxValue = maxValue;
+	MarkAttributeRowDirty(*index);
+	OnAttributeRowChanged.Broadcast(this, *index);
+}
+
+void UXeusAbilitySystemViewModel::MarkAttributeRowDirty(int32 Row)
+{
+	if (DirtyAttributeFlags[Row])
+		return;
+	DirtyAttributeFlags[Row] = true;
+	DirtyAttributeRows.Add(Row);
+}
+
+void UXeusAbilitySystemViewModel::AddEffectRow(UXeusEffect* Effect)
+{
+	if (EffectIndices.Contains(Effect))
+		return;
+
+	EffectIndices.Add(Effect, EffectRows.Num());
+	EffectRows.Add(MakeEffectRow(Effect));
+	bEffectRowsChanged = true;
+	OnEffectRowsChanged.Broadcast(this);
+}
+
+void UXeusAbilitySystemViewModel::RemoveEffectRow(UXeusEffect* Effect)
+{
+	int32 index = INDEX_NONE;
+	if (!EffectIndices.RemoveAndCopyValue(Effect, index))
+		return;
+
+	// Order of rows is kept, so rows after removed one move up
+	EffectRows.RemoveAt(index);
+	for (int32 i = index; i < EffectRows.Num(); ++i)
+		EffectIndices[EffectRows[i].Ref] = i;
+
+	bEffectRowsChanged = true;
+	OnEffectRowsChanged.Broadcast(this);
+}
+
+void UXeusAbilitySystemViewModel::Component_ValueChanged(UXeusAbilitySystemComponent* Component,
+                                                         UXeusAttribute* Attribute, float Value)
+{
+	UpdateAttributeRow(Attribute);
+}
+
+void UXeusAbilitySystemViewModel::Component_AttributeAdded(UXeusAbilitySystemComponent* Component,
+                                                           UXeusAttribute* Attribute)
+{
+	MarkAttributeRowDirty(AddAttributeRow(Attribute));
+	OnAttributeRowsChanged.Broadcast(this);
+}
+
+void UXeusAbilitySystemViewModel::Component_AttributeRemoved(UXeusAbilitySystemComponent* Component,
+                                                             UXeusAttribute* Attribute)
+{
+	RemoveAttributeRow(Attribute);
+}
+
+void UXeusAbilitySystemViewModel::Component_EffectStarted(UXeusAbilitySystemComponent* Component,
+                                                          UXeusEffect* Effect)
+{
+	AddEffectRow(Effect);
+}
+
+void UXeusAbilitySystemViewModel::Component_EffectEnded(UXeusAbilitySystemComponent* Component, UXeusEffect* Effect)
+{
+	RemoveEffectRow(Effect);
+}
+
+void UXeusAbilitySystemViewModel::Attribute_MultChanged(UXeusAttribute* Attribute, FName UniqueId)
+{
+	// Widgets can show multiplied values, so row is changed even if raw values are the same
+	UpdateAttributeRow(Attribute, true);
+}
+
+void UXeusAbilitySystemViewModel::Attribute_MultRemoved(UXeusAttribute* Attribute)
+{
+	UpdateAttributeRow(Attribute, true);
+}
+
+void UXeusAbilitySystemViewModel::Component_StateReset(UXeusAbilitySystemComponent* Component)
+{
+	Rebuild();
+}
+
+const TArray<FAttributeData>& UXeusAbilitySystemViewModel::GetAttributeRows() const
+{
+	return AttributeRows;
+}
+
+const TArray<FEffectData>& UXeusAbilitySystemViewModel::GetEffectRows() const
+{
+	return EffectRows;
+}
+
+int32 UXeusAbilitySystemViewModel::GetAttributeRowCount() const
+{
+	return AttributeRows.Num();
+}
+
+FAttributeData UXeusAbilitySystemViewModel::GetAttributeRow(int32 Row) const
+{
+	return AttributeRows.IsValidIndex(Row) ? AttributeRows[Row] : FAttributeData();
+}
+
+int32 UXeusAbilitySystemViewModel::GetEffectRowCount() const
+{
+	return EffectRows.Num();
+}
+
+FEffectData UXeusAbilitySystemViewModel::GetEffectRow(int32 Row) const
+{
+	return EffectRows.IsValidIndex(Row) ? EffectRows[Row] : FEffectData();
+}
+
+bool UXeusAbilitySystemViewModel::ConsumeDirtyAttributeRows(TArray<int32>& OutRows)
+{
+	OutRows.Reset();
+	if (DirtyAttributeRows.Num() == 0)
+		return false;
+
+	Swap(OutRows, DirtyAttributeRows);
+	for (const int32 row : OutRows)
+		DirtyAttributeFlags[row] = false;
+	return true;
+}
+
+bool UXeusAbilitySystemViewModel::ConsumeEffectRowsChanged()
+{
+	const bool bChanged = bEffectRowsChanged;
+	bEffectRowsChanged = false;
+	return bChanged;
+}
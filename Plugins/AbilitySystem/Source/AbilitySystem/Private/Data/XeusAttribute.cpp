@@ -2,7 +2,7 @@
 
 #include "Data/XeusAttribute.h"
 #include "AbilitySystemTypes.h"
-#include "Algo/IndexOf.h"
+#include "Data/XeusAttributeSetDefinition.h"
 #include "Net/UnrealNetwork.h"
 
 FAttributeMultiplier::FAttributeMultiplier()
@@ -39,6 +39,24 @@ bool FAttributeMultiplier::HasSameType(const FAttributeMultiplier& Other) const
 	return Other.Type == this->Type;
 }
 
+FAttributeMultiplierBucket::FAttributeMultiplierBucket()
+	: Product(1.0f)
+	  , bProductDirty(false)
+{
+}
+
+void FAttributeMultiplierBucket::Add(float InValue)
+{
+	if (!bProductDirty)
+		Product *= InValue;
+}
+
+void FAttributeMultiplierBucket::Reset()
+{
+	Product = 1.0f;
+	bProductDirty = false;
+}
+
 UXeusAttribute::UXeusAttribute(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
@@ -46,6 +64,7 @@ UXeusAttribute::UXeusAttribute(const FObjectInitializer& ObjectInitializer)
 	MinValue = 0.0f;
 	DefaultValue = 100.0f;
 	CurrentValue = DefaultValue;
+	DefinitionSet = nullptr;
 }
 
 UXeusAttribute* UXeusAttribute::CreateAttributeFromClass(TSubclassOf<UXeusAttribute> InClass, UObject* Outer)
@@ -55,65 +74,158 @@ UXeusAttribute* UXeusAttribute::CreateAttributeFromClass(TSubclassOf<UXeusAttrib
 	return Attribute;
 }
 
-TArray<const FAttributeMultiplier*> UXeusAttribute::GetMultsByType(EAttributeMultiplierType InType) const
+bool UXeusAttribute::InitFromDefinition(UXeusAttributeSetDefinition* InSet)
 {
-	TArray<const FAttributeMultiplier*> pointers;
-	for (int32 i = 0; i < Mults.Num(); ++i)
+	const FXeusAttributeDefinition* definition = InSet ? InSet->FindDefinition(GetClass()) : nullptr;
+	if (!definition)
+		return false;
+
+	// Min and max are runtime state of instance (changed by SetMinValue/SetMaxValue), default value is not copied
+	DefinitionSet = InSet;
+	MinValue = definition->MinValue;
+	MaxValue = definition->MaxValue;
+	CurrentValue = FMath::Clamp(definition->DefaultValue, MinValue, MaxValue);
+	return true;
+}
+
+void UXeusAttribute::SerializeState(FArchive& Ar)
+{
+	Ar << CurrentValue;
+	Ar << MaxValue;
+	Ar << MinValue;
+
+	int32 count = Mults.Num();
+	Ar << count;
+
+	if (Ar.IsSaving())
 	{
-		if (Mults[i].Type == InType)
+		for (FAttributeMultiplier& mult : Mults)
 		{
-			const FAttributeMultiplier* p = &Mults[i];
-			pointers.Add(p);
+			uint8 type = static_cast<uint8>(mult.Type);
+			Ar << mult.UniqueId;
+			Ar << mult.Value;
+			Ar << type;
 		}
+		return;
 	}
+
+	Mults.Reset();
+	MultIndices.Reset();
+	for (FAttributeMultiplierBucket& bucket : MultBuckets)
+		bucket.Reset();
+
+	for (int32 i = 0; i < count && !Ar.IsError(); ++i)
+	{
+		FAttributeMultiplier mult;
+		uint8 type = 0;
+		Ar << mult.UniqueId;
+		Ar << mult.Value;
+		Ar << type;
+		mult.Type = static_cast<EAttributeMultiplierType>(type);
+		if (mult.Type < EAttributeMultiplierType::MAX && !MultIndices.Contains(mult.UniqueId))
+		{
+			MultIndices.Add(mult.UniqueId, Mults.Add(mult));
+			GetMultBucket(mult.Type).Add(mult.Value);
+		}
+	}
+}
+
+float UXeusAttribute::GetDefaultValue() const
+{
+	const FXeusAttributeDefinition* definition = DefinitionSet ? DefinitionSet->FindDefinition(GetClass()) : nullptr;
+	return definition ? definition->DefaultValue : DefaultValue;
+}
+
+FAttributeMultiplierBucket& UXeusAttribute::GetMultBucket(EAttributeMultiplierType InType) const
+{
+	check(InType < EAttributeMultiplierType::MAX);
+	return MultBuckets[static_cast<int32>(InType)];
+}
+
+void UXeusAttribute::RemoveMultAt(int32 Index)
+{
+	GetMultBucket(Mults[Index].Type).bProductDirty = true;
+	Mults.RemoveAtSwap(Index, 1, false);
+	if (Mults.IsValidIndex(Index))
+		MultIndices[Mults[Index].UniqueId] = Index;
+}
+
+TArray<const FAttributeMultiplier*> UXeusAttribute::GetMultsByType(EAttributeMultiplierType InType) const
+{
+	TArray<const FAttributeMultiplier*> pointers;
+	for (int32 i = 0; i < Mults.Num(); ++i)
+		if (Mults[i].Type == InType)
+			pointers.Add(&Mults[i]);
 	return pointers;
 }
 
 TArray<FAttributeMultiplier> UXeusAttribute::GetMults(EAttributeMultiplierType InType)
 {
-	return Mults.FilterByPredicate([InType](const FAttributeMultiplier& A)
+	return Mults.FilterByPredicate([InType](const FAttributeMultiplier& Mult)
 	{
-		return A.Type == InType;
+		return Mult.Type == InType;
 	});
 }
 
 float UXeusAttribute::GetMultValue(EAttributeMultiplierType InType) const
 {
-	float Value = 1.0f;
-	if (Mults.Num() == 0)
-		return Value;
-
-	const TArray<const FAttributeMultiplier*> pointers = GetMultsByType(InType);
-	for (const FAttributeMultiplier* pointer : pointers)
-		Value *= pointer->Value;
-	return Value;
+	FAttributeMultiplierBucket& bucket = GetMultBucket(InType);
+	if (bucket.bProductDirty)
+	{
+		bucket.Product = 1.0f;
+		for (const FAttributeMultiplier& mult : Mults)
+			if (mult.Type == InType)
+				bucket.Product *= mult.Value;
+		bucket.bProductDirty = false;
+	}
+	return bucket.Product;
 }
 
 bool UXeusAttribute::AddMult(FAttributeMultiplier InMult)
 {
-	const FAttributeMultiplier* res = GetMult(InMult.UniqueId);
-	if (res != nullptr)
+	if (InMult.Type >= EAttributeMultiplierType::MAX || MultIndices.Contains(InMult.UniqueId))
 		return false;
 
-	Mults.Add(InMult);
+	MultIndices.Add(InMult.UniqueId, Mults.Add(InMult));
+	GetMultBucket(InMult.Type).Add(InMult.Value);
 	OnMultAdded.Broadcast(this, InMult.UniqueId);
 	return true;
 }
 
 bool UXeusAttribute::RemoveMult(FName InId)
 {
-	const int32 index = Algo::IndexOfByPredicate(Mults,
-	                                             [InId](const FAttributeMultiplier& AttributeMultiplier)
-	                                             {
-		                                             return AttributeMultiplier.UniqueId == InId;
-	                                             });
-	if (index == -1)
+	int32 index = INDEX_NONE;
+	if (!MultIndices.RemoveAndCopyValue(InId, index))
 		return false;
-	Mults.RemoveAt(index);
+
+	RemoveMultAt(index);
 	OnMultRemoved.Broadcast(this);
 	return true;
 }
 
+void UXeusAttribute::SetMult(FAttributeMultiplier InMult)
+{
+	const int32* index = MultIndices.Find(InMult.UniqueId);
+	if (index == nullptr)
+	{
+		AddMult(InMult);
+		return;
+	}
+
+	if (InMult.Type >= EAttributeMultiplierType::MAX)
+		return;
+
+	FAttributeMultiplier& mult = Mults[*index];
+	if (mult.HasSameType(InMult) && mult.HasSameValue(InMult))
+		return;
+
+	GetMultBucket(mult.Type).bProductDirty = true;
+	GetMultBucket(InMult.Type).bProductDirty = true;
+	mult.Value = InMult.Value;
+	mult.Type = InMult.Type;
+	OnMultChanged.Broadcast(this, InMult.UniqueId);
+}
+
 void UXeusAttribute::GetMultById(FName InId, FAttributeMultiplier& OutMult, bool& bOutSuccess)
 {
 	const FAttributeMultiplier* res = GetMult(InId);
@@ -130,14 +242,8 @@ void UXeusAttribute::GetMultById(FName InId, FAttributeMultiplier& OutMult, bool
 
 const FAttributeMultiplier* UXeusAttribute::GetMult(FName InId) const
 {
-	if (Mults.Num() == 0)
-		return nullptr;
-
-	for (int32 i = 0; i < Mults.Num(); ++i)
-		if (Mults[i].UniqueId == InId)
-			return &Mults[i];
-
-	return nullptr;
+	const int32* index = MultIndices.Find(InId);
+	return index ? &Mults[*index] : nullptr;
 }
 
 void UXeusAttribute::SetCurrentValue(float InValue, bool useMult)
@@ -232,6 +338,21 @@ FString UXeusAttribute::GetDebugName()
 	return GetClass()->GetName();
 }
 
+const FXeusClassDisplayName& UXeusAttribute::GetClassDisplayName() const
+{
+	return FXeusClassDisplayName::Find(GetClass(), GetClass()->GetDefaultObject<UXeusAttribute>()->DisplayName);
+}
+
+FText UXeusAttribute::GetDisplayName() const
+{
+	return GetClassDisplayName().Text;
+}
+
+FName UXeusAttribute::GetDisplayId() const
+{
+	return GetClassDisplayName().Id;
+}
+
 void UXeusAttribute::EditValue(EAttributeModifyType ModifyType, float Value)
 {
 	switch (ModifyType)
@@ -0,0 +1,76 @@
+﻿// Developed by OIC
+
+
+#include "Data/XeusAttributeSetDefinition.h"
+
+#include "Data/XeusAttribute.h"
+
+FXeusAttributeDefinition::FXeusAttributeDefinition()
+	: AttributeClass(nullptr)
+	  , MinValue(0.0f)
+	  , MaxValue(100.0f)
+	  , DefaultValue(100.0f)
+{
+}
+
+void UXeusAttributeSetDefinition::BuildDefinitions() const
+{
+	Definitions.Reset();
+	DefinitionIndices.Reset();
+
+	for (const FXeusAttributeDefinition& definition : Attributes)
+		Definitions.Add(&definition);
+
+	if (AttributesTable && AttributesTable->GetRowStruct() &&
+		AttributesTable->GetRowStruct()->IsChildOf(FXeusAttributeDefinition::StaticStruct()))
+	{
+		for (const auto& row : AttributesTable->GetRowMap())
+			Definitions.Add(reinterpret_cast<const FXeusAttributeDefinition*>(row.Value));
+	}
+
+	for (int32 i = 0; i < Definitions.Num(); ++i)
+		if (Definitions[i]->AttributeClass)
+			if (!DefinitionIndices.Contains(Definitions[i]->AttributeClass))
+				DefinitionIndices.Add(Definitions[i]->AttributeClass, i);
+}
+
+void UXeusAttributeSetDefinition::PostLoad()
+{
+	Super::PostLoad();
+	BuildDefinitions();
+
+#if WITH_EDITOR
+	// Row memory of table is reallocated on reimport and row edits
+	if (AttributesTable)
+		AttributesTable->OnDataTableChanged().AddUObject(this, &UXeusAttributeSetDefinition::BuildDefinitions);
+#endif
+}
+
+#if WITH_EDITOR
+void UXeusAttributeSetDefinition::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	BuildDefinitions();
+
+	if (AttributesTable && !AttributesTable->OnDataTableChanged().IsBoundToObject(this))
+		AttributesTable->OnDataTableChanged().AddUObject(this, &UXeusAttributeSetDefinition::BuildDefinitions);
+}
+#endif
+
+const TArray<const FXeusAttributeDefinition*>& UXeusAttributeSetDefinition::GetDefinitions() const
+{
+	if (Definitions.Num() == 0)
+		BuildDefinitions();
+	return Definitions;
+}
+
+const FXeusAttributeDefinition* UXeusAttributeSetDefinition::FindDefinition(TSubclassOf<UXeusAttribute> InClass) const
+{
+	const int32* index = DefinitionIndices.Find(InClass);
+	if (!index && Definitions.Num() == 0)
+	{
+		BuildDefinitions();
+		index = DefinitionIndices.Find(InClass);
+	}
+	return index ? Definitions[*index] : nullptr;
+}
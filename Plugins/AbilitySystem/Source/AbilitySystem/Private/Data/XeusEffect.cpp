@@ -2,7 +2,12 @@
 
 
 #include "Data/XeusEffect.h"
-#include "Algo/IndexOf.h"
+
+#include "AbilitySystem.h"
+#include "Components/XeusAbilitySystemComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "UObject/ObjectKey.h"
 
 FXeusEffectModifier::FXeusEffectModifier()
 {
@@ -14,11 +19,77 @@ FXeusEffectModifier::FXeusEffectModifier(FName Id, float Val)
 	: UniquedId(Id)
 	, Value(Val) { }
 
+FXeusEffectAttributeLink::FXeusEffectAttributeLink()
+	: Attribute(nullptr)
+	, Type(EAttributeMultiplierType::Get) { }
+
+FXeusEffectAttributeLink::FXeusEffectAttributeLink(TSubclassOf<UXeusAttribute> InAttribute,
+                                                   EAttributeMultiplierType InType)
+	: Attribute(InAttribute)
+	, Type(InType) { }
+
+FXeusEffectStack::FXeusEffectStack()
+	: Source(nullptr)
+	, ApplyTime(0.0f) { }
+
+FXeusEffectStack::FXeusEffectStack(UObject* InSource, float InApplyTime)
+	: Source(InSource)
+	, ApplyTime(InApplyTime) { }
+
+const FXeusClassDisplayName& FXeusClassDisplayName::Find(const UClass* InClass, const FText& CustomText)
+{
+	check(IsInGameThread());
+	// Key has serial number of class, so recompiled blueprint class is resolved again
+	// Names are allocated separately, references stay valid when map grows
+	static TMap<FObjectKey, TUniquePtr<FXeusClassDisplayName>> cache;
+	TUniquePtr<FXeusClassDisplayName>& name = cache.FindOrAdd(FObjectKey(InClass));
+	if (!name.IsValid())
+	{
+		name = MakeUnique<FXeusClassDisplayName>();
+		name->Resolve(InClass, CustomText);
+	}
+	return *name;
+}
+
+FXeusEffectContext::FXeusEffectContext()
+	: Instigator(nullptr)
+	, Source(nullptr) { }
+
+FXeusEffectContext::FXeusEffectContext(AActor* InInstigator, UObject* InSource)
+	: Instigator(InInstigator)
+	, Source(InSource) { }
+
+FXeusEffectSettings::FXeusEffectSettings()
+	: bOverrideMagnitude(false)
+	, bOverrideDuration(false)
+	, bOverridePeriod(false)
+	, Magnitude(1.0f)
+	, Duration(1.0f)
+	, Period(1.0f) { }
+
+FXeusEffectHandle::FXeusEffectHandle()
+	: Index(INDEX_NONE)
+	, Generation(0)
+	, Owner(0) { }
+
+FXeusEffectHandle::FXeusEffectHandle(int32 InIndex, int32 InGeneration, int32 InOwner)
+	: Index(InIndex)
+	, Generation(InGeneration)
+	, Owner(InOwner) { }
+
 UXeusEffect::UXeusEffect(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	AbilitySystem = nullptr;
 	bDisplayable = false;
+	TotalModifier = 1.0f;
+	MaxStacks = 1;
+	StackDurationPolicy = EXeusStackDurationPolicy::None;
+	StackSourcePolicy = EXeusStackSourcePolicy::Aggregate;
+	StackOverflowPolicy = EXeusStackOverflowPolicy::Reject;
+	bGrantedTagsWithParentsCached = false;
+	RollbackSerial = 0;
+	bPoolable = false;
 }
 
 UXeusEffect* UXeusEffect::CreateEffect(TSubclassOf<UXeusEffect> InClass, UObject* Outer)
@@ -28,6 +99,12 @@ UXeusEffect* UXeusEffect::CreateEffect(TSubclassOf<UXeusEffect> InClass, UObject
 	return Effect;
 }
 
+void UXeusEffect::PostInitProperties()
+{
+	Super::PostInitProperties();
+	RebuildModifierCache();
+}
+
 void UXeusEffect::EndWork_Implementation()
 {
 	OnNeedRemove.Broadcast(this);
@@ -38,15 +115,211 @@ void UXeusEffect::Work_Implementation()
 	EndWork();
 }
 
-void UXeusEffect::Setup(FXeusEffectSettings* Settings) { }
+void UXeusEffect::Setup(const FXeusEffectSettings& Settings)
+{
+	AppliedSettings = Settings;
+	for (const FXeusEffectModifier& mod : Settings.Modifiers)
+		ApplyModifier(mod);
+}
+
+const FGameplayTagContainer& UXeusEffect::GetGrantedTags() const
+{
+	return GrantedTags;
+}
+
+const FGameplayTagContainer& UXeusEffect::GetGrantedTagsWithParents() const
+{
+	if (!bGrantedTagsWithParentsCached)
+	{
+		GrantedTagsWithParents = GrantedTags.GetGameplayTagParents();
+		bGrantedTagsWithParentsCached = true;
+	}
+	return GrantedTagsWithParents;
+}
+
+const FGameplayTagContainer& UXeusEffect::GetBlockedTags() const
+{
+	return BlockedTags;
+}
 
 bool UXeusEffect::GetIsStackable() const
 {
 	return bStackable;
 }
 
+bool UXeusEffect::GetIsPoolable() const
+{
+	return bPoolable;
+}
+
 void UXeusEffect::Stack(TSubclassOf<UXeusEffect> InClass) { }
 
+void UXeusEffect::StackCountChanged_Implementation(int32 OldCount, int32 NewCount) { }
+
+void UXeusEffect::RefreshDuration() { }
+
+void UXeusEffect::ExtendDuration() { }
+
+void UXeusEffect::InitStacks(UObject* Source, float ApplyTime)
+{
+	Stacks.Reset();
+	Stacks.Emplace(Source, ApplyTime);
+}
+
+int32 UXeusEffect::FindStack(const UObject* Source) const
+{
+	return Stacks.IndexOfByPredicate([Source](const FXeusEffectStack& InStack)
+	{
+		return InStack.Source.Get() == Source;
+	});
+}
+
+bool UXeusEffect::AddStack(UObject* Source)
+{
+	if (!bStackable)
+		return false;
+
+	const int32 oldCount = Stacks.Num();
+	// Component clock is paused, scaled and stepped deterministically unlike world time
+	const float now = static_cast<float>(GetEffectTime());
+
+	if (StackSourcePolicy == EXeusStackSourcePolicy::PerSource)
+	{
+		const int32 index = FindStack(Source);
+		if (index != INDEX_NONE)
+		{
+			// Refreshed stack becomes the newest one
+			Stacks.RemoveAt(index, 1, false);
+			Stacks.Emplace(Source, now);
+			HandleStacksChanged(oldCount);
+			return true;
+		}
+	}
+
+	if (Stacks.Num() >= GetMaxStacks())
+	{
+		if (StackOverflowPolicy == EXeusStackOverflowPolicy::Reject || Stacks.Num() == 0)
+			return false;
+		Stacks.RemoveAt(0, 1, false);
+	}
+
+	Stacks.Emplace(Source, now);
+	HandleStacksChanged(oldCount);
+	return true;
+}
+
+void UXeusEffect::HandleStacksChanged(int32 OldCount)
+{
+	switch (StackDurationPolicy)
+	{
+	default:
+	case EXeusStackDurationPolicy::None:
+		break;
+	case EXeusStackDurationPolicy::Refresh:
+		RefreshDuration();
+		break;
+	case EXeusStackDurationPolicy::Extend:
+		ExtendDuration();
+		break;
+	}
+
+	if (OldCount != Stacks.Num())
+	{
+		StackCountChanged(OldCount, Stacks.Num());
+		OnStackCountChanged.Broadcast(this, Stacks.Num());
+	}
+	MarkStateChanged();
+}
+
+int32 UXeusEffect::RemoveStacks(int32 Count)
+{
+	const int32 oldCount = Stacks.Num();
+	const int32 removed = FMath::Clamp(Count, 0, oldCount);
+	if (removed == 0)
+		return 0;
+
+	Stacks.RemoveAt(oldCount - removed, removed, false);
+	StackCountChanged(oldCount, Stacks.Num());
+	OnStackCountChanged.Broadcast(this, Stacks.Num());
+	MarkStateChanged();
+
+	if (Stacks.Num() == 0)
+		EndWork();
+	return removed;
+}
+
+int32 UXeusEffect::RemoveStacksFromSource(UObject* Source)
+{
+	const int32 oldCount = Stacks.Num();
+	Stacks.RemoveAll([Source](const FXeusEffectStack& InStack)
+	{
+		return InStack.Source.Get() == Source;
+	});
+
+	const int32 removed = oldCount - Stacks.Num();
+	if (removed == 0)
+		return 0;
+
+	StackCountChanged(oldCount, Stacks.Num());
+	OnStackCountChanged.Broadcast(this, Stacks.Num());
+	MarkStateChanged();
+
+	if (Stacks.Num() == 0)
+		EndWork();
+	return removed;
+}
+
+bool UXeusEffect::RemoveStack(const FXeusEffectStack& Stack)
+{
+	// Newest stacks are checked first, they are more likely to be removed
+	int32 index = Stacks.Num() - 1;
+	for (; index >= 0; --index)
+		if (Stacks[index].Source == Stack.Source && Stacks[index].ApplyTime == Stack.ApplyTime)
+			break;
+	if (index == INDEX_NONE)
+		return false;
+
+	const int32 oldCount = Stacks.Num();
+	Stacks.RemoveAt(index, 1, false);
+	StackCountChanged(oldCount, Stacks.Num());
+	OnStackCountChanged.Broadcast(this, Stacks.Num());
+	MarkStateChanged();
+
+	if (Stacks.Num() == 0)
+		EndWork();
+	return true;
+}
+
+int32 UXeusEffect::GetStackCount() const
+{
+	return Stacks.Num();
+}
+
+int32 UXeusEffect::GetMaxStacks() const
+{
+	return bStackable ? FMath::Max(MaxStacks, 1) : 1;
+}
+
+int32 UXeusEffect::GetStackCountFromSource(UObject* Source) const
+{
+	int32 count = 0;
+	for (const FXeusEffectStack& stack : Stacks)
+		if (stack.Source.Get() == Source)
+			++count;
+	return count;
+}
+
+FXeusEffectStack UXeusEffect::GetStack(int32 Index) const
+{
+	return Stacks.IsValidIndex(Index) ? Stacks[Index] : FXeusEffectStack();
+}
+
+void UXeusEffect::SetStackSource(int32 Index, UObject* Source)
+{
+	if (Stacks.IsValidIndex(Index))
+		Stacks[Index].Source = Source;
+}
+
 void UXeusEffect::NotifyBeginWork(UXeusAbilitySystemComponent* InAbilitySystem)
 {
 	check(InAbilitySystem);
@@ -54,11 +327,175 @@ void UXeusEffect::NotifyBeginWork(UXeusAbilitySystemComponent* InAbilitySystem)
 	Work();
 }
 
+void UXeusEffect::NotifyRestored(UXeusAbilitySystemComponent* InAbilitySystem)
+{
+	check(InAbilitySystem);
+	this->AbilitySystem = InAbilitySystem;
+	RestoreWork();
+}
+
+void UXeusEffect::RestoreWork() { }
+
+uint32 UXeusEffect::GetRollbackSerial() const
+{
+	return RollbackSerial;
+}
+
+void UXeusEffect::SetRollbackSerial(uint32 InSerial)
+{
+	RollbackSerial = InSerial;
+}
+
+void UXeusEffect::SerializeState(FArchive& Ar)
+{
+	int32 stackCount = Stacks.Num();
+	Ar << stackCount;
+	if (Ar.IsLoading())
+		Stacks.SetNum(FMath::Max(stackCount, 0));
+	// Sources are runtime objects and are not saved
+	for (FXeusEffectStack& stack : Stacks)
+		Ar << stack.ApplyTime;
+
+	int32 modifierCount = Modifiers.Num();
+	Ar << modifierCount;
+	if (Ar.IsLoading())
+		Modifiers.SetNum(FMath::Max(modifierCount, 0));
+	for (FXeusEffectModifier& mod : Modifiers)
+	{
+		Ar << mod.UniquedId;
+		Ar << mod.Value;
+	}
+
+	if (Ar.IsLoading())
+		RebuildModifierCache();
+}
+
+void UXeusEffect::ResetState_Implementation()
+{
+	const UXeusEffect* defaults = GetClass()->GetDefaultObject<UXeusEffect>();
+	AbilitySystem = nullptr;
+	RollbackSerial = 0;
+	SetContext(FXeusEffectContext());
+	AppliedSettings = FXeusEffectSettings();
+	EffectHandle.Invalidate();
+	Stacks.Reset();
+	Modifiers = defaults->Modifiers;
+	RebuildModifierCache();
+
+	// Listeners of previous owner must not receive events of next one
+	OnNeedRemove.Clear();
+	OnTotalModifierChanged.Clear();
+	OnStackCountChanged.Clear();
+}
+
 void UXeusEffect::NotifyEndWork()
 {
 	EndWork();
 }
 
+UXeusAbilitySystemComponent* UXeusEffect::GetAbilitySystem() const
+{
+	return AbilitySystem;
+}
+
+AActor* UXeusEffect::GetOwnerActor() const
+{
+	return AbilitySystem ? AbilitySystem->GetOwner() : Cast<AActor>(GetOuter());
+}
+
+void UXeusEffect::SetContext(const FXeusEffectContext& InContext)
+{
+	Context = InContext;
+	const AActor* instigator = Context.Instigator.Get();
+	InstigatorKey = instigator ? FObjectKey(instigator) : FObjectKey();
+}
+
+void UXeusEffect::RestoreContext(const FXeusEffectContext& InContext, FObjectKey InInstigatorKey)
+{
+	Context = InContext;
+	InstigatorKey = InInstigatorKey;
+}
+
+void UXeusEffect::RestoreAppliedSettings(const FXeusEffectSettings& InSettings)
+{
+	AppliedSettings = InSettings;
+}
+
+const FXeusEffectContext& UXeusEffect::GetContext() const
+{
+	return Context;
+}
+
+const FXeusEffectSettings& UXeusEffect::GetAppliedSettings() const
+{
+	return AppliedSettings;
+}
+
+AActor* UXeusEffect::GetInstigator() const
+{
+	return Context.Instigator.Get();
+}
+
+UObject* UXeusEffect::GetEffectSource() const
+{
+	return Context.Source.Get();
+}
+
+FObjectKey UXeusEffect::GetInstigatorKey() const
+{
+	return InstigatorKey;
+}
+
+void UXeusEffect::SetHandle(const FXeusEffectHandle& InHandle)
+{
+	EffectHandle = InHandle;
+}
+
+FXeusEffectHandle UXeusEffect::GetHandle() const
+{
+	return EffectHandle;
+}
+
+void UXeusEffect::MarkStateChanged() const
+{
+	if (AbilitySystem)
+		AbilitySystem->MarkStateChanged();
+}
+
+bool UXeusEffect::IsEffectActive() const
+{
+	// Component releases handle when effect is unlinked
+	return AbilitySystem && EffectHandle.IsValid();
+}
+
+double UXeusEffect::GetEffectTime() const
+{
+	if (AbilitySystem)
+		return AbilitySystem->GetEffectTime();
+
+	const UWorld* world = GetWorld();
+	return world ? world->GetTimeSeconds() : 0.0;
+}
+
+FXeusEffectTimerHandle UXeusEffect::SetEffectTimer(FSimpleDelegate Callback, float Delay, bool bLoop, float Rate) const
+{
+	// Clock belongs to component, timers can be set from Work or RestoreWork only
+	if (!ensureMsgf(AbilitySystem, TEXT("%s: effect timer was set before effect started work"), *GetName()))
+	{
+		UE_LOG(AbilitySystemLog, Error, TEXT("%s: effect timer was set before effect started work and is ignored"),
+		       *GetName());
+		return FXeusEffectTimerHandle();
+	}
+	return AbilitySystem->SetEffectTimer(MoveTemp(Callback), Delay, bLoop, Rate);
+}
+
+void UXeusEffect::ClearEffectTimer(FXeusEffectTimerHandle& Handle) const
+{
+	if (AbilitySystem)
+		AbilitySystem->ClearEffectTimer(Handle);
+	Handle.Invalidate();
+}
+
 void UXeusEffect::EffectAdded_Implementation(UXeusEffect* InEffect)
 {
 	
@@ -74,6 +511,21 @@ FString UXeusEffect::GetDebugName() const
 	return GetClass()->GetName();
 }
 
+const FXeusClassDisplayName& UXeusEffect::GetClassDisplayName() const
+{
+	return FXeusClassDisplayName::Find(GetClass(), GetClass()->GetDefaultObject<UXeusEffect>()->DisplayName);
+}
+
+FText UXeusEffect::GetDisplayName() const
+{
+	return GetClassDisplayName().Text;
+}
+
+FName UXeusEffect::GetDisplayId() const
+{
+	return GetClassDisplayName().Id;
+}
+
 TSoftObjectPtr<UTexture2D> UXeusEffect::GetIcon() const
 {
 	return Icon;
@@ -90,38 +542,73 @@ bool UXeusEffect::GetIsDisplayable() const
 }
 
 float UXeusEffect::GetTotalModifier() const
+{
+	return TotalModifier;
+}
+
+void UXeusEffect::RebuildModifierCache()
+{
+	ModifierIndices.Reset();
+	for (int32 i = 0; i < Modifiers.Num(); ++i)
+		ModifierIndices.Add(Modifiers[i].UniquedId, i);
+	RecalculateTotalModifier();
+}
+
+void UXeusEffect::RecalculateTotalModifier()
 {
 	float res = 1.0f;
 	for (const auto& mod : Modifiers)
 		res *= mod.Value;
-	return res;
+	TotalModifier = res;
 }
 
 int32 UXeusEffect::FindModifier(FName UniqueId) const
 {
-	return Algo::IndexOfByPredicate(Modifiers,
-		[UniqueId](const FXeusEffectModifier& Mod) {
-			return Mod.UniquedId == UniqueId;
-		});
+	const int32* index = ModifierIndices.Find(UniqueId);
+	return index ? *index : INDEX_NONE;
 }
 
 bool UXeusEffect::HasModifier(FName UniqueId) const
 {
-	return FindModifier(UniqueId) != -1;
+	return FindModifier(UniqueId) != INDEX_NONE;
 }
 
 void UXeusEffect::ApplyModifier(FXeusEffectModifier Mod)
 {
 	const int32 index = FindModifier(Mod.UniquedId);
-	if (index != -1)
+	if (index != INDEX_NONE)
+	{
+		if (Modifiers[index].Value == Mod.Value)
+			return;
 		Modifiers[index].Value = Mod.Value;
+		RecalculateTotalModifier();
+	}
 	else
-		Modifiers.Add(Mod);
+	{
+		ModifierIndices.Add(Mod.UniquedId, Modifiers.Add(Mod));
+		TotalModifier *= Mod.Value;
+	}
+	OnTotalModifierChanged.Broadcast(this, TotalModifier);
+	MarkStateChanged();
 }
 
 void UXeusEffect::RemoveModifier(FName UniqueId)
 {
 	const int32 index = FindModifier(UniqueId);
-	if (index != -1)
-		Modifiers.RemoveAt(index);
+	if (index == INDEX_NONE)
+		return;
+
+	ModifierIndices.Remove(UniqueId);
+	Modifiers.RemoveAtSwap(index);
+	if (Modifiers.IsValidIndex(index))
+		ModifierIndices.Add(Modifiers[index].UniquedId, index);
+
+	RecalculateTotalModifier();
+	OnTotalModifierChanged.Broadcast(this, TotalModifier);
+	MarkStateChanged();
+}
+
+const TArray<FXeusEffectAttributeLink>& UXeusEffect::GetModifierTargets() const
+{
+	return ModifierTargets;
 }
@@ -0,0 +1,9 @@
+﻿// Developed by OIC
+
+
+#include "Data/XeusEffectBundle.h"
+
+UXeusEffectBundle::UXeusEffectBundle()
+{
+	bPreloadIcons = true;
+}
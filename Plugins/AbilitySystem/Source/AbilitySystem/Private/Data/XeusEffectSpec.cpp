@@ -0,0 +1,11 @@
+﻿// Developed by OIC
+
+
+#include "Data/XeusEffectSpec.h"
+
+#include "Data/XeusEffect.h"
+
+UXeusEffectSpec::UXeusEffectSpec()
+{
+	EffectClass = nullptr;
+}
@@ -11,12 +11,14 @@ TArray<FAttributeData> UXeusAbilitySystemLib::GetAttributeData(UXeusAbilitySyste
 	TArray<FAttributeData> res;
 	if (AbilitySystemComponentRef)
 	{
-		TArray<UXeusAttribute*> Attributes = AbilitySystemComponentRef->GetAttributes();
+		const TArray<UXeusAttribute*>& Attributes = AbilitySystemComponentRef->GetAttributesRef();
+		res.Reserve(Attributes.Num());
 		for (int32 i = 0; i < Attributes.Num(); ++i)
 		{
+			const FXeusClassDisplayName& name = Attributes[i]->GetClassDisplayName();
 			res.Add({
-				Attributes[i], Attributes[i]->GetDebugName(), Attributes[i]->GetCurrentValue(),
-				Attributes[i]->GetMaxValue()
+				Attributes[i], name.Name, Attributes[i]->GetCurrentValue(), Attributes[i]->GetMaxValue(), name.Text,
+				name.Id
 			});
 		}
 	}
@@ -28,10 +30,12 @@ TArray<FEffectData> UXeusAbilitySystemLib::GetEffectData(UXeusAbilitySystemCompo
 	TArray<FEffectData> res;
 	if (AbilitySystemComponentRef)
 	{
-		TArray<UXeusEffect*> Effects = AbilitySystemComponentRef->GetEffects();
+		const TArray<UXeusEffect*>& Effects = AbilitySystemComponentRef->GetEffectsRef();
+		res.Reserve(Effects.Num());
 		for (int32 i = 0; i < Effects.Num(); ++i)
 		{
-			res.Add({Effects[i], Effects[i]->GetDebugName()});
+			const FXeusClassDisplayName& name = Effects[i]->GetClassDisplayName();
+			res.Add({Effects[i], name.Name, name.Text, name.Id});
 		}
 	}
 	return res;
@@ -0,0 +1,448 @@
+﻿// Developed by OIC
+
+#include "Subsystems/XeusAbilityQuerySubsystem.h"
+
+#include "Components/XeusAbilitySystemComponent.h"
+
+#include "Algo/BinarySearch.h"
+#include "GameFramework/Actor.h"
+
+FXeusAreaShape::FXeusAreaShape()
+	: Type(EXeusAreaShapeType::Sphere)
+	, Center(FVector::ZeroVector)
+	, Radius(500.0f)
+	, Extent(500.0f)
+	, Rotation(FRotator::ZeroRotator) { }
+
+bool FXeusAreaShape::Contains(const FVector& Point) const
+{
+	const FVector offset = Point - Center;
+	switch (Type)
+	{
+	case EXeusAreaShapeType::Cylinder:
+		return FMath::Abs(offset.Z) <= Extent.Z && offset.SizeSquared2D() <= FMath::Square(Radius);
+	case EXeusAreaShapeType::Box:
+		{
+			const FVector local = Rotation.UnrotateVector(offset);
+			return FMath::Abs(local.X) <= Extent.X && FMath::Abs(local.Y) <= Extent.Y && FMath::Abs(local.Z) <= Extent.Z;
+		}
+	default:
+		return offset.SizeSquared() <= FMath::Square(Radius);
+	}
+}
+
+FBox FXeusAreaShape::GetBounds() const
+{
+	switch (Type)
+	{
+	case EXeusAreaShapeType::Cylinder:
+		return FBox(Center - FVector(Radius, Radius, Extent.Z), Center + FVector(Radius, Radius, Extent.Z));
+	case EXeusAreaShapeType::Box:
+		return FBox(-Extent, Extent).TransformBy(FTransform(Rotation, Center));
+	default:
+		return FBox(Center - FVector(Radius), Center + FVector(Radius));
+	}
+}
+
+void UXeusAbilityQuerySubsystem::Deinitialize()
+{
+	for (const auto& pair : SpatialEntries)
+		if (USceneComponent* root = pair.Value.Root.Get())
+			root->TransformUpdated.Remove(pair.Value.TransformHandle);
+	SpatialEntries.Empty();
+	Cells.Empty();
+	Movers.Empty();
+	Components.Empty();
+	ComponentsByEffect.Empty();
+	Rankings.Empty();
+	Super::Deinitialize();
+}
+
+void UXeusAbilityQuerySubsystem::RegisterComponent(UXeusAbilitySystemComponent* Component)
+{
+	if (!Component)
+		return;
+
+	bool bAlreadyRegistered = false;
+	Components.Add(Component, &bAlreadyRegistered);
+	if (bAlreadyRegistered)
+	{
+		RemoveComponentState(Component);
+		RemoveSpatialEntry(Component);
+	}
+	AddComponentState(Component);
+	AddSpatialEntry(Component);
+	OnComponentRegistered.Broadcast(Component);
+}
+
+void UXeusAbilityQuerySubsystem::UnregisterComponent(UXeusAbilitySystemComponent* Component)
+{
+	if (Components.Remove(Component) > 0)
+	{
+		OnComponentUnregistered.Broadcast(Component);
+		RemoveComponentState(Component);
+		RemoveSpatialEntry(Component);
+	}
+}
+
+void UXeusAbilityQuerySubsystem::RefreshComponent(UXeusAbilitySystemComponent* Component)
+{
+	if (!Components.Contains(Component))
+		return;
+
+	RemoveComponentState(Component);
+	AddComponentState(Component);
+}
+
+void UXeusAbilityQuerySubsystem::AddComponentState(UXeusAbilitySystemComponent* Component)
+{
+	for (const UXeusEffect* effect : Component->GetEffectsRef())
+		if (effect)
+			NotifyEffectAdded(Component, effect);
+	for (const UXeusAttribute* attribute : Component->GetAttributesRef())
+		if (attribute)
+			NotifyAttributeChanged(Component, attribute);
+}
+
+void UXeusAbilityQuerySubsystem::RemoveComponentState(UXeusAbilitySystemComponent* Component)
+{
+	NotifyAllEffectsRemoved(Component);
+	NotifyAllAttributesRemoved(Component);
+}
+
+void UXeusAbilityQuerySubsystem::NotifyEffectAdded(UXeusAbilitySystemComponent* Component, const UXeusEffect* Effect)
+{
+	// Effect is counted for its parent classes, so queries by base class are lookups too
+	for (UClass* cls = Effect->GetClass(); cls && cls != UXeusEffect::StaticClass(); cls = cls->GetSuperClass())
+		++ComponentsByEffect.FindOrAdd(cls).FindOrAdd(Component);
+}
+
+void UXeusAbilityQuerySubsystem::NotifyEffectRemoved(UXeusAbilitySystemComponent* Component, const UXeusEffect* Effect)
+{
+	for (UClass* cls = Effect->GetClass(); cls && cls != UXeusEffect::StaticClass(); cls = cls->GetSuperClass())
+	{
+		TMap<UXeusAbilitySystemComponent*, int32>* counts = ComponentsByEffect.Find(cls);
+		if (!counts)
+			continue;
+
+		int32* count = counts->Find(Component);
+		if (count && --(*count) <= 0)
+		{
+			counts->Remove(Component);
+			if (counts->Num() == 0)
+				ComponentsByEffect.Remove(cls);
+		}
+	}
+}
+
+void UXeusAbilityQuerySubsystem::NotifyAllEffectsRemoved(UXeusAbilitySystemComponent* Component)
+{
+	for (auto it = ComponentsByEffect.CreateIterator(); it; ++it)
+	{
+		it.Value().Remove(Component);
+		if (it.Value().Num() == 0)
+			it.RemoveCurrent();
+	}
+}
+
+void UXeusAbilityQuerySubsystem::AddRankEntry(FXeusAttributeRanking& Ranking, UXeusAbilitySystemComponent* Component,
+                                              float Percent)
+{
+	const float* current = Ranking.Percents.Find(Component);
+	// Only first change is remembered, it is percent of entry in Sorted
+	if (!Ranking.Changed.Contains(Component))
+		Ranking.Changed.Add(Component, current ? TOptional<float>(*current) : TOptional<float>());
+	Ranking.Percents.Add(Component, Percent);
+}
+
+void UXeusAbilityQuerySubsystem::RemoveRankEntry(FXeusAttributeRanking& Ranking, UXeusAbilitySystemComponent* Component)
+{
+	float current = 0.0f;
+	if (!Ranking.Percents.RemoveAndCopyValue(Component, current))
+		return;
+	if (!Ranking.Changed.Contains(Component))
+		Ranking.Changed.Add(Component, current);
+}
+
+const TArray<FXeusAttributeRankEntry>& UXeusAbilityQuerySubsystem::GetSortedEntries(
+	const FXeusAttributeRanking& Ranking)
+{
+	// Values can change many times per frame, so ranking is updated once when it is read
+	if (Ranking.Changed.Num() == 0)
+		return Ranking.Sorted;
+
+	if (Ranking.Changed.Num() * 2 > Ranking.Sorted.Num())
+	{
+		// Most entries changed, full sort is cheaper than moving them one by one
+		Ranking.Sorted.Reset(Ranking.Percents.Num());
+		for (const auto& pair : Ranking.Percents)
+			Ranking.Sorted.Add({pair.Value, pair.Key});
+		Ranking.Sorted.Sort();
+	}
+	else
+	{
+		for (const auto& pair : Ranking.Changed)
+		{
+			if (pair.Value.IsSet())
+			{
+				const FXeusAttributeRankEntry old{pair.Value.GetValue(), pair.Key};
+				const int32 index = Algo::LowerBound(Ranking.Sorted, old);
+				if (Ranking.Sorted.IsValidIndex(index) && Ranking.Sorted[index].Component == pair.Key)
+					Ranking.Sorted.RemoveAt(index, 1, false);
+			}
+
+			if (const float* percent = Ranking.Percents.Find(pair.Key))
+			{
+				const FXeusAttributeRankEntry entry{*percent, pair.Key};
+				Ranking.Sorted.Insert(entry, Algo::LowerBound(Ranking.Sorted, entry));
+			}
+		}
+	}
+	Ranking.Changed.Reset();
+	return Ranking.Sorted;
+}
+
+void UXeusAbilityQuerySubsystem::NotifyAttributeChanged(UXeusAbilitySystemComponent* Component,
+                                                        const UXeusAttribute* Attribute)
+{
+	float percent = Attribute->GetPercent();
+	// Attribute with equal min and max has no percent
+	if (!FMath::IsFinite(percent))
+		percent = 0.0f;
+
+	FXeusAttributeRanking& ranking = Rankings.FindOrAdd(Attribute->GetClass());
+	const float* current = ranking.Percents.Find(Component);
+	if (!current || *current != percent)
+		AddRankEntry(ranking, Component, percent);
+}
+
+void UXeusAbilityQuerySubsystem::NotifyAttributeRemoved(UXeusAbilitySystemComponent* Component,
+                                                        const UXeusAttribute* Attribute)
+{
+	if (FXeusAttributeRanking* ranking = Rankings.Find(Attribute->GetClass()))
+		RemoveRankEntry(*ranking, Component);
+}
+
+void UXeusAbilityQuerySubsystem::NotifyAllAttributesRemoved(UXeusAbilitySystemComponent* Component)
+{
+	for (auto& pair : Rankings)
+		RemoveRankEntry(pair.Value, Component);
+}
+
+bool UXeusAbilityQuerySubsystem::ComponentHasEffect(UXeusAbilitySystemComponent* Component,
+                                                    TSubclassOf<UXeusEffect> InClass) const
+{
+	const TMap<UXeusAbilitySystemComponent*, int32>* counts = ComponentsByEffect.Find(InClass.Get());
+	return counts && counts->Contains(Component);
+}
+
+int32 UXeusAbilityQuerySubsystem::GetComponentsWithEffect(TSubclassOf<UXeusEffect> InClass,
+                                                          TArray<UXeusAbilitySystemComponent*>& OutComponents) const
+{
+	OutComponents.Reset();
+	if (const TMap<UXeusAbilitySystemComponent*, int32>* counts = ComponentsByEffect.Find(InClass.Get()))
+		counts->GenerateKeyArray(OutComponents);
+	return OutComponents.Num();
+}
+
+int32 UXeusAbilityQuerySubsystem::GetComponentsWithoutEffect(TSubclassOf<UXeusEffect> InClass,
+                                                             TArray<UXeusAbilitySystemComponent*>& OutComponents) const
+{
+	OutComponents.Reset();
+	const TMap<UXeusAbilitySystemComponent*, int32>* counts = ComponentsByEffect.Find(InClass.Get());
+	for (UXeusAbilitySystemComponent* component : Components)
+		if (!counts || !counts->Contains(component))
+			OutComponents.Add(component);
+	return OutComponents.Num();
+}
+
+int32 UXeusAbilityQuerySubsystem::GetEffectComponentCount(TSubclassOf<UXeusEffect> InClass) const
+{
+	const TMap<UXeusAbilitySystemComponent*, int32>* counts = ComponentsByEffect.Find(InClass.Get());
+	return counts ? counts->Num() : 0;
+}
+
+int32 UXeusAbilityQuerySubsystem::GetComponentsByAttributePercent(TSubclassOf<UXeusAttribute> InClass, int32 Count,
+                                                                  bool bHighest,
+                                                                  TArray<UXeusAbilitySystemComponent*>& OutComponents)
+const
+{
+	OutComponents.Reset();
+	if (Count <= 0)
+		return 0;
+
+	ForEachByAttributePercent(InClass, bHighest, [&](UXeusAbilitySystemComponent* Component, float Percent)
+	{
+		OutComponents.Add(Component);
+		return OutComponents.Num() < Count;
+	});
+	return OutComponents.Num();
+}
+
+void UXeusAbilityQuerySubsystem::ForEachByAttributePercent(TSubclassOf<UXeusAttribute> InClass, bool bHighest,
+                                                           TFunctionRef<bool(UXeusAbilitySystemComponent*, float)>
+                                                           Visitor) const
+{
+	const FXeusAttributeRanking* ranking = Rankings.Find(InClass.Get());
+	if (!ranking)
+		return;
+
+	const TArray<FXeusAttributeRankEntry>& sorted = GetSortedEntries(*ranking);
+	if (bHighest)
+	{
+		for (int32 i = sorted.Num() - 1; i >= 0; --i)
+			if (!Visitor(sorted[i].Component, sorted[i].Percent))
+				return;
+	}
+	else
+	{
+		for (int32 i = 0; i < sorted.Num(); ++i)
+			if (!Visitor(sorted[i].Component, sorted[i].Percent))
+				return;
+	}
+}
+
+int32 UXeusAbilityQuerySubsystem::GetComponentsInAttributePercentRange(TSubclassOf<UXeusAttribute> InClass,
+                                                                       float MinPercent, float MaxPercent,
+                                                                       TArray<UXeusAbilitySystemComponent*>&
+                                                                       OutComponents) const
+{
+	OutComponents.Reset();
+	const FXeusAttributeRanking* ranking = Rankings.Find(InClass.Get());
+	if (!ranking)
+		return 0;
+
+	const TArray<FXeusAttributeRankEntry>& sorted = GetSortedEntries(*ranking);
+	for (int32 i = Algo::LowerBound(sorted, FXeusAttributeRankEntry{MinPercent, nullptr});
+	     i < sorted.Num() && sorted[i].Percent <= MaxPercent; ++i)
+		OutComponents.Add(sorted[i].Component);
+	return OutComponents.Num();
+}
+
+FIntPoint UXeusAbilityQuerySubsystem::GetCell(const FVector& Location)
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UXeusAbilityQuerySubsystem::AddSpatialEntry(UXeusAbilitySystemComponent* Component)
+{
+	const AActor* owner = Component->GetOwner();
+	USceneComponent* root = owner ? owner->GetRootComponent() : nullptr;
+	if (!root)
+		return;
+
+	FXeusSpatialEntry& entry = SpatialEntries.Add(Component);
+	entry.Location = root->GetComponentLocation();
+	entry.Cell = GetCell(entry.Location);
+	entry.Root = root;
+	entry.TransformHandle = root->TransformUpdated.AddUObject(
+		this, &UXeusAbilityQuerySubsystem::OnRootTransformUpdated, Component);
+	Cells.FindOrAdd(entry.Cell).Add(Component);
+}
+
+void UXeusAbilityQuerySubsystem::RemoveSpatialEntry(UXeusAbilitySystemComponent* Component)
+{
+	FXeusSpatialEntry entry;
+	if (!SpatialEntries.RemoveAndCopyValue(Component, entry))
+		return;
+
+	if (USceneComponent* root = entry.Root.Get())
+		root->TransformUpdated.Remove(entry.TransformHandle);
+
+	if (TArray<UXeusAbilitySystemComponent*>* cell = Cells.Find(entry.Cell))
+	{
+		cell->RemoveSingleSwap(Component);
+		if (cell->Num() == 0)
+			Cells.Remove(entry.Cell);
+	}
+	Movers.Remove(Component);
+}
+
+void UXeusAbilityQuerySubsystem::OnRootTransformUpdated(USceneComponent* Root, EUpdateTransformFlags Flags,
+                                                        ETeleportType Teleport,
+                                                        UXeusAbilitySystemComponent* Component)
+{
+	// Hash is updated lazily, owner can move several times per frame
+	Movers.Add(Component);
+}
+
+void UXeusAbilityQuerySubsystem::FlushMovers()
+{
+	if (Movers.Num() == 0)
+		return;
+
+	// Listeners can query hash, so it is emptied first
+	const TSet<UXeusAbilitySystemComponent*> moved = MoveTemp(Movers);
+	Movers.Reset();
+
+	for (UXeusAbilitySystemComponent* component : moved)
+	{
+		FXeusSpatialEntry* entry = SpatialEntries.Find(component);
+		const USceneComponent* root = entry ? entry->Root.Get() : nullptr;
+		if (!root)
+			continue;
+
+		entry->Location = root->GetComponentLocation();
+		const FIntPoint cell = GetCell(entry->Location);
+		if (cell != entry->Cell)
+		{
+			if (TArray<UXeusAbilitySystemComponent*>* oldCell = Cells.Find(entry->Cell))
+			{
+				oldCell->RemoveSingleSwap(component);
+				if (oldCell->Num() == 0)
+					Cells.Remove(entry->Cell);
+			}
+			Cells.FindOrAdd(cell).Add(component);
+			entry->Cell = cell;
+		}
+	}
+
+	for (UXeusAbilitySystemComponent* component : moved)
+		if (SpatialEntries.Contains(component))
+			OnComponentMoved.Broadcast(component);
+}
+
+int32 UXeusAbilityQuerySubsystem::GetComponentsInShape(const FXeusAreaShape& Shape,
+                                                       TArray<UXeusAbilitySystemComponent*>& OutComponents)
+{
+	FlushMovers();
+	OutComponents.Reset();
+
+	const FBox bounds = Shape.GetBounds();
+	const FIntPoint minCell = GetCell(bounds.Min);
+	const FIntPoint maxCell = GetCell(bounds.Max);
+
+	auto collect = [&](const TArray<UXeusAbilitySystemComponent*>& Cell)
+	{
+		for (UXeusAbilitySystemComponent* component : Cell)
+			if (Shape.Contains(SpatialEntries.FindChecked(component).Location))
+				OutComponents.Add(component);
+	};
+
+	// Huge areas cover more cells than there are occupied ones
+	const int64 cellCount = static_cast<int64>(maxCell.X - minCell.X + 1) * (maxCell.Y - minCell.Y + 1);
+	if (cellCount > Cells.Num())
+	{
+		for (const auto& pair : Cells)
+			if (pair.Key.X >= minCell.X && pair.Key.X <= maxCell.X && pair.Key.Y >= minCell.Y && pair.Key.Y <= maxCell.Y)
+				collect(pair.Value);
+		return OutComponents.Num();
+	}
+
+	for (int32 x = minCell.X; x <= maxCell.X; ++x)
+		for (int32 y = minCell.Y; y <= maxCell.Y; ++y)
+			if (const TArray<UXeusAbilitySystemComponent*>* cell = Cells.Find(FIntPoint(x, y)))
+				collect(*cell);
+	return OutComponents.Num();
+}
+
+bool UXeusAbilityQuerySubsystem::GetComponentLocation(UXeusAbilitySystemComponent* Component,
+                                                      FVector& OutLocation) const
+{
+	const FXeusSpatialEntry* entry = SpatialEntries.Find(Component);
+	if (!entry)
+		return false;
+
+	OutLocation = entry->Location;
+	return true;
+}
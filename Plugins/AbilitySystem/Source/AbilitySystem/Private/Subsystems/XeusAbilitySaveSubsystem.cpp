@@ -0,0 +1,382 @@
+﻿// Developed by OIC
+
+#include "Subsystems/XeusAbilitySaveSubsystem.h"
+
+#include "AbilitySystem.h"
+#include "Components/XeusAbilitySystemComponent.h"
+
+#include "Algo/Count.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+UXeusAbilitySaveSubsystem::UXeusAbilitySaveSubsystem()
+{
+	bSaving = false;
+	bLoading = false;
+}
+
+void UXeusAbilitySaveSubsystem::Deinitialize()
+{
+	// Background tasks hold their own data and weak pointer to subsystem
+	Components.Empty();
+	PendingSnapshots.Empty();
+	SnapshotCache.Empty();
+	Super::Deinitialize();
+}
+
+void UXeusAbilitySaveSubsystem::RegisterComponent(UXeusAbilitySystemComponent* Component)
+{
+	if (!Component)
+		return;
+
+	const FName saveId = Component->GetSaveId();
+	if (saveId.IsNone())
+		return;
+
+	Components.Add(saveId, Component);
+	RestorePending(Component);
+}
+
+void UXeusAbilitySaveSubsystem::UnregisterComponent(UXeusAbilitySystemComponent* Component)
+{
+	if (!Component)
+		return;
+
+	const FName saveId = Component->GetSaveId();
+	const TWeakObjectPtr<UXeusAbilitySystemComponent>* found = Components.Find(saveId);
+	if (found && found->Get() == Component)
+	{
+		Components.Remove(saveId);
+		SnapshotCache.Remove(saveId);
+	}
+}
+
+bool UXeusAbilitySaveSubsystem::RestorePending(UXeusAbilitySystemComponent* Component)
+{
+	const FName saveId = Component->GetSaveId();
+	FXeusSharedAbilitySnapshot snapshot;
+	if (!PendingSnapshots.RemoveAndCopyValue(saveId, snapshot) || !snapshot.IsValid())
+		return false;
+
+	return Component->RestoreSnapshot(*snapshot);
+}
+
+UXeusAbilitySystemComponent* UXeusAbilitySaveSubsystem::FindComponent(FName SaveId) const
+{
+	const TWeakObjectPtr<UXeusAbilitySystemComponent>* found = Components.Find(SaveId);
+	return found ? found->Get() : nullptr;
+}
+
+int32 UXeusAbilitySaveSubsystem::CaptureAll(TArray<FXeusAbilitySaveRecord>& OutRecords)
+{
+	OutRecords.Reset(Components.Num());
+	int32 captured = 0;
+	for (const auto& pair : Components)
+	{
+		UXeusAbilitySystemComponent* component = pair.Value.Get();
+		if (!component)
+			continue;
+
+		FXeusAbilitySnapshotCache& cache = SnapshotCache.FindOrAdd(pair.Key);
+		if (!cache.Snapshot.IsValid() || cache.Component.Get() != component ||
+			cache.Revision != component->GetStateRevision())
+		{
+			// Previous snapshot can still be read by background save, so it is replaced, not overwritten
+			FXeusSharedAbilitySnapshot snapshot = MakeShared<FXeusAbilitySystemSnapshot, ESPMode::ThreadSafe>();
+			component->CaptureSnapshotTo(*snapshot);
+			cache.Component = component;
+			cache.Revision = component->GetStateRevision();
+			cache.Snapshot = snapshot;
+			++captured;
+		}
+
+		FXeusAbilitySaveRecord& record = OutRecords.AddDefaulted_GetRef();
+		record.SaveId = pair.Key;
+		record.Snapshot = cache.Snapshot;
+	}
+	return captured;
+}
+
+bool UXeusAbilitySaveSubsystem::SaveToFile(const FString& FileName)
+{
+	if (bSaving)
+		return false;
+
+	// Game thread only captures, records are owned by background task after that
+	TSharedRef<TArray<FXeusAbilitySaveRecord>, ESPMode::ThreadSafe> records =
+		MakeShared<TArray<FXeusAbilitySaveRecord>, ESPMode::ThreadSafe>();
+	CaptureAll(*records);
+	bSaving = true;
+
+	const FString filePath = GetSaveFilePath(FileName);
+	TWeakObjectPtr<UXeusAbilitySaveSubsystem> weakThis(this);
+	Async(EAsyncExecution::ThreadPool, [records, filePath, FileName, weakThis]()
+	{
+		const bool bSuccess = WriteRecords(filePath, *records);
+		AsyncTask(ENamedThreads::GameThread, [weakThis, FileName, bSuccess]()
+		{
+			if (UXeusAbilitySaveSubsystem* subsystem = weakThis.Get())
+				subsystem->SaveFinished(FileName, bSuccess);
+		});
+	});
+	return true;
+}
+
+void UXeusAbilitySaveSubsystem::SaveFinished(FString FileName, bool bSuccess)
+{
+	bSaving = false;
+	if (!bSuccess)
+		UE_LOG(AbilitySystemLog, Error, TEXT("Failed to save ability state to %s"), *FileName);
+	OnSaveFinished.Broadcast(FileName, bSuccess);
+}
+
+bool UXeusAbilitySaveSubsystem::LoadFromFile(const FString& FileName)
+{
+	if (bLoading)
+		return false;
+	bLoading = true;
+
+	const FString filePath = GetSaveFilePath(FileName);
+	TWeakObjectPtr<UXeusAbilitySaveSubsystem> weakThis(this);
+	Async(EAsyncExecution::ThreadPool, [filePath, FileName, weakThis]()
+	{
+		TSharedRef<TArray<FXeusAbilitySaveRecord>, ESPMode::ThreadSafe> records =
+			MakeShared<TArray<FXeusAbilitySaveRecord>, ESPMode::ThreadSafe>();
+		const bool bSuccess = ReadRecords(filePath, *records);
+		AsyncTask(ENamedThreads::GameThread, [weakThis, FileName, records, bSuccess]()
+		{
+			if (UXeusAbilitySaveSubsystem* subsystem = weakThis.Get())
+				subsystem->LoadFinished(FileName, records, bSuccess);
+		});
+	});
+	return true;
+}
+
+void UXeusAbilitySaveSubsystem::LoadFinished(FString FileName,
+                                             TSharedRef<TArray<FXeusAbilitySaveRecord>, ESPMode::ThreadSafe> Records,
+                                             bool bSuccess)
+{
+	bLoading = false;
+	if (!bSuccess)
+	{
+		UE_LOG(AbilitySystemLog, Error, TEXT("Failed to load ability state from %s"), *FileName);
+		OnLoadFinished.Broadcast(FileName, false);
+		return;
+	}
+
+	// Components that are not streamed in yet are restored at their begin play
+	PendingSnapshots.Reserve(PendingSnapshots.Num() + Records->Num());
+	for (FXeusAbilitySaveRecord& record : *Records)
+		PendingSnapshots.Add(record.SaveId, MoveTemp(record.Snapshot));
+	// Restored components will have new state revision
+	SnapshotCache.Empty();
+
+	for (const auto& pair : Components)
+		if (UXeusAbilitySystemComponent* component = pair.Value.Get())
+			RestorePending(component);
+
+	OnLoadFinished.Broadcast(FileName, true);
+}
+
+bool UXeusAbilitySaveSubsystem::IsBusy() const
+{
+	return bSaving || bLoading;
+}
+
+int32 UXeusAbilitySaveSubsystem::GetPendingCount() const
+{
+	return PendingSnapshots.Num();
+}
+
+bool UXeusAbilitySaveSubsystem::WriteRecords(const FString& FilePath, const TArray<FXeusAbilitySaveRecord>& Records)
+{
+	// File is written next to target and replaces it only when complete
+	const FString tempPath = FilePath + TEXT(".tmp");
+	TUniquePtr<FArchive> file(IFileManager::Get().CreateFileWriter(*tempPath));
+	if (!file)
+		return false;
+
+	TArray<uint8> chunk;
+	chunk.Reserve(ChunkSize);
+	FMemoryWriter writer(chunk);
+
+	uint32 magic = FileMagic;
+	int32 version = FileVersion;
+	int32 count = Algo::CountIf(Records, [](const FXeusAbilitySaveRecord& Record)
+	{
+		return Record.Snapshot.IsValid();
+	});
+	writer << magic;
+	writer << version;
+	writer << count;
+
+	for (const FXeusAbilitySaveRecord& record : Records)
+	{
+		if (!record.Snapshot.IsValid())
+			continue;
+
+		FString saveId = record.SaveId.ToString();
+		int32 snapshotVersion = record.Snapshot->Version;
+		int32 size = record.Snapshot->Data.Num();
+		writer << saveId;
+		writer << snapshotVersion;
+		writer << size;
+		writer.Serialize(const_cast<uint8*>(record.Snapshot->Data.GetData()), size);
+
+		if (chunk.Num() >= ChunkSize)
+		{
+			file->Serialize(chunk.GetData(), chunk.Num());
+			chunk.Reset();
+			writer.Seek(0);
+		}
+	}
+
+	if (chunk.Num() > 0)
+		file->Serialize(chunk.GetData(), chunk.Num());
+
+	const bool bSuccess = file->Close() && !file->IsError();
+	file.Reset();
+
+	if (!bSuccess)
+	{
+		IFileManager::Get().Delete(*tempPath);
+		return false;
+	}
+	return IFileManager::Get().Move(*FilePath, *tempPath, true);
+}
+
+bool UXeusAbilitySaveSubsystem::ReadRecords(const FString& FilePath, TArray<FXeusAbilitySaveRecord>& OutRecords)
+{
+	TUniquePtr<FArchive> file(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!file)
+		return false;
+
+	uint32 magic = 0;
+	int32 version = 0;
+	int32 count = 0;
+	*file << magic;
+	*file << version;
+	*file << count;
+	if (file->IsError() || magic != FileMagic || version > FileVersion || count < 0)
+		return false;
+
+	OutRecords.Reset(count);
+	for (int32 i = 0; i < count; ++i)
+	{
+		FString saveId;
+		int32 snapshotVersion = 0;
+		int32 size = 0;
+		*file << saveId;
+		*file << snapshotVersion;
+		*file << size;
+		if (file->IsError() || size < 0 || size > file->TotalSize() - file->Tell())
+			return false;
+
+		FXeusAbilitySaveRecord& record = OutRecords.AddDefaulted_GetRef();
+		record.SaveId = FName(*saveId);
+		record.Snapshot = MakeShared<FXeusAbilitySystemSnapshot, ESPMode::ThreadSafe>();
+		record.Snapshot->Version = snapshotVersion;
+		record.Snapshot->Data.SetNumUninitialized(size);
+		file->Serialize(record.Snapshot->Data.GetData(), size);
+	}
+
+	return file->Close() && !file->IsError();
+}
+
+FString UXeusAbilitySaveSubsystem::GetSaveFilePath(const FString& FileName)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("AbilitySystem"), FileName);
+}
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Xeus.AbilitySave.Benchmark [Count]
+ * Spawns Count isolated components (1000 by default) with state of first registered component,
+ * captures them twice (second capture reuses unchanged snapshots), writes, reads and restores them
+ */
+static void RunAbilitySaveBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	UXeusAbilitySaveSubsystem* subsystem = World ? World->GetSubsystem<UXeusAbilitySaveSubsystem>() : nullptr;
+	if (!subsystem)
+		return;
+
+	TArray<FXeusAbilitySaveRecord> records;
+	subsystem->CaptureAll(records);
+	const FXeusSharedAbilitySnapshot templateSnapshot = records.Num() > 0 ? records[0].Snapshot : nullptr;
+
+	// Every spawned actor has its own component, gameplay components are never restored
+	const int32 count = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+	FActorSpawnParameters params;
+	params.ObjectFlags |= RF_Transient;
+	TArray<AActor*> actors;
+	TSet<FName> spawnedIds;
+	actors.Reserve(count);
+	for (int32 i = 0; i < count; ++i)
+	{
+		AActor* actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, params);
+		if (!actor)
+			continue;
+
+		UXeusAbilitySystemComponent* component = NewObject<UXeusAbilitySystemComponent>(actor);
+		component->RegisterComponent();
+		if (templateSnapshot.IsValid())
+			component->RestoreSnapshot(*templateSnapshot);
+		actors.Add(actor);
+		spawnedIds.Add(component->GetSaveId());
+	}
+
+	double start = FPlatformTime::Seconds();
+	const int32 captured = subsystem->CaptureAll(records);
+	const double captureTime = FPlatformTime::Seconds() - start;
+
+	start = FPlatformTime::Seconds();
+	const int32 recaptured = subsystem->CaptureAll(records);
+	const double recaptureTime = FPlatformTime::Seconds() - start;
+
+	const FString filePath = UXeusAbilitySaveSubsystem::GetSaveFilePath(TEXT("Benchmark.xas"));
+	start = FPlatformTime::Seconds();
+	const bool bWritten = UXeusAbilitySaveSubsystem::WriteRecords(filePath, records);
+	const double writeTime = FPlatformTime::Seconds() - start;
+
+	TArray<FXeusAbilitySaveRecord> loaded;
+	start = FPlatformTime::Seconds();
+	const bool bRead = UXeusAbilitySaveSubsystem::ReadRecords(filePath, loaded);
+	const double readTime = FPlatformTime::Seconds() - start;
+
+	int32 restored = 0;
+	start = FPlatformTime::Seconds();
+	for (const FXeusAbilitySaveRecord& record : loaded)
+	{
+		if (!spawnedIds.Contains(record.SaveId))
+			continue;
+		if (UXeusAbilitySystemComponent* component = subsystem->FindComponent(record.SaveId))
+			if (component->RestoreSnapshot(*record.Snapshot))
+				++restored;
+	}
+	const double restoreTime = FPlatformTime::Seconds() - start;
+
+	const int64 fileSize = IFileManager::Get().FileSize(*filePath);
+	IFileManager::Get().Delete(*filePath);
+	for (AActor* actor : actors)
+		actor->Destroy();
+
+	UE_LOG(AbilitySystemLog, Display,
+	       TEXT("Ability save benchmark: %d components (%d spawned), %lld bytes, capture %.2f ms (%d serialized), recapture %.2f ms (%d serialized), write %.2f ms%s, read %.2f ms%s, restore %.3f ms per component"),
+	       records.Num(), actors.Num(), fileSize, captureTime * 1000.0, captured, recaptureTime * 1000.0, recaptured,
+	       writeTime * 1000.0, bWritten ? TEXT("") : TEXT(" (failed)"),
+	       readTime * 1000.0, bRead ? TEXT("") : TEXT(" (failed)"),
+	       restored > 0 ? restoreTime * 1000.0 / restored : 0.0);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GAbilitySaveBenchmarkCommand(
+	TEXT("Xeus.AbilitySave.Benchmark"),
+	TEXT("Spawn N components (default 1000), capture, write, read and restore their ability state"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunAbilitySaveBenchmark));
+
+#endif
@@ -0,0 +1,87 @@
+﻿// Developed by OIC
+
+#include "Subsystems/XeusAreaEffectSubsystem.h"
+
+#include "Components/XeusAbilitySystemComponent.h"
+#include "Subsystems/XeusAbilityQuerySubsystem.h"
+
+#include "Engine/World.h"
+
+void UXeusAreaEffectSubsystem::Deinitialize()
+{
+	for (const auto& pair : Pools)
+		for (UXeusEffect* effect : pair.Value.Effects)
+			if (effect)
+				effect->ConditionalBeginDestroy();
+	Pools.Empty();
+	TargetsScratch.Empty();
+	Super::Deinitialize();
+}
+
+FXeusAreaEffectReport UXeusAreaEffectSubsystem::ApplyEffectInArea(const FXeusAreaShape& Shape,
+                                                                  TSubclassOf<UXeusEffect> InClass, UObject* Source)
+{
+	UXeusAbilityQuerySubsystem* querySubsystem = GetWorld()->GetSubsystem<UXeusAbilityQuerySubsystem>();
+	if (!InClass || !querySubsystem)
+		return FXeusAreaEffectReport();
+
+	querySubsystem->GetComponentsInShape(Shape, TargetsScratch);
+
+	// Scratch array is taken, because effects can apply other area effects while working
+	TArray<UXeusAbilitySystemComponent*> targets = MoveTemp(TargetsScratch);
+	const FXeusAreaEffectReport report = ApplyEffectToTargets(targets, InClass, Source);
+	TargetsScratch = MoveTemp(targets);
+	return report;
+}
+
+FXeusAreaEffectReport UXeusAreaEffectSubsystem::ApplyEffectToTargets(
+	TArrayView<UXeusAbilitySystemComponent* const> Targets, TSubclassOf<UXeusEffect> InClass, UObject* Source)
+{
+	FXeusAreaEffectReport report;
+	if (!InClass || InClass->HasAnyClassFlags(CLASS_Abstract))
+		return report;
+
+	// Class default object is the shared immutable definition (tags, stacking rules),
+	// instances of poolable effects are taken from pool by components
+	report.Targets = Targets.Num();
+	for (UXeusAbilitySystemComponent* target : Targets)
+	{
+		if (IsValid(target) && target->AddEffectFromSource(InClass, Source))
+			++report.Applied;
+		else
+			++report.Resisted;
+	}
+	return report;
+}
+
+UXeusEffect* UXeusAreaEffectSubsystem::AcquireEffect(TSubclassOf<UXeusEffect> InClass)
+{
+	if (FXeusEffectPool* pool = Pools.Find(InClass))
+		if (pool->Effects.Num() > 0)
+			return pool->Effects.Pop(false);
+
+	// Subsystem is outer of pooled effects, so they outlive their components
+	return UXeusEffect::CreateEffect(InClass, this);
+}
+
+void UXeusAreaEffectSubsystem::ReleaseEffect(UXeusEffect* InEffect)
+{
+	if (!InEffect)
+		return;
+
+	FXeusEffectPool& pool = Pools.FindOrAdd(InEffect->GetClass());
+	if (pool.Effects.Num() >= MaxPooledPerClass || InEffect->GetOuter() != this)
+	{
+		InEffect->ConditionalBeginDestroy();
+		return;
+	}
+
+	InEffect->ResetState();
+	pool.Effects.Add(InEffect);
+}
+
+int32 UXeusAreaEffectSubsystem::GetPooledCount(TSubclassOf<UXeusEffect> InClass) const
+{
+	const FXeusEffectPool* pool = Pools.Find(InClass.Get());
+	return pool ? pool->Effects.Num() : 0;
+}
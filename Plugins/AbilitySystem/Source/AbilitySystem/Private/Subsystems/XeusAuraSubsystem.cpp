@@ -0,0 +1,381 @@
+﻿// Developed by OIC
+
+#include "Subsystems/XeusAuraSubsystem.h"
+
+#include "Components/XeusAbilitySystemComponent.h"
+#include "Components/SceneComponent.h"
+#include "Data/XeusEffect.h"
+#include "Subsystems/XeusAbilityQuerySubsystem.h"
+
+#include "Engine/World.h"
+
+UXeusAuraSubsystem::UXeusAuraSubsystem()
+{
+	LastAuraId = 0;
+}
+
+void UXeusAuraSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UXeusAbilityQuerySubsystem* querySubsystem = Collection.InitializeDependency<UXeusAbilityQuerySubsystem>();
+	if (!querySubsystem)
+		return;
+
+	// Newly registered component is checked as if it moved
+	MovedHandle = querySubsystem->OnComponentMoved.AddUObject(this, &UXeusAuraSubsystem::Component_Moved);
+	RegisteredHandle = querySubsystem->OnComponentRegistered.AddUObject(this, &UXeusAuraSubsystem::Component_Moved);
+	UnregisteredHandle = querySubsystem->OnComponentUnregistered.AddUObject(
+		this, &UXeusAuraSubsystem::Component_Unregistered);
+}
+
+void UXeusAuraSubsystem::Deinitialize()
+{
+	if (UXeusAbilityQuerySubsystem* querySubsystem = GetWorld()->GetSubsystem<UXeusAbilityQuerySubsystem>())
+	{
+		querySubsystem->OnComponentMoved.Remove(MovedHandle);
+		querySubsystem->OnComponentRegistered.Remove(RegisteredHandle);
+		querySubsystem->OnComponentUnregistered.Remove(UnregisteredHandle);
+	}
+
+	for (const auto& pair : Auras)
+		if (USceneComponent* attach = pair.Value.Attach.Get())
+			attach->TransformUpdated.Remove(pair.Value.TransformHandle);
+	Auras.Empty();
+	AuraCells.Empty();
+	Memberships.Empty();
+	DirtyComponents.Empty();
+	DirtyAuras.Empty();
+	AttachedAuras.Empty();
+	Super::Deinitialize();
+}
+
+void UXeusAuraSubsystem::Tick(float DeltaTime)
+{
+	UpdateAuras();
+}
+
+bool UXeusAuraSubsystem::IsTickable() const
+{
+	return Auras.Num() > 0 && !IsTemplate();
+}
+
+TStatId UXeusAuraSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UXeusAuraSubsystem, STATGROUP_Tickables);
+}
+
+UWorld* UXeusAuraSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+#pragma region Membership
+
+void UXeusAuraSubsystem::Component_Moved(UXeusAbilitySystemComponent* Component)
+{
+	if (Auras.Num() > 0)
+		DirtyComponents.Add(Component);
+}
+
+void UXeusAuraSubsystem::Component_Unregistered(UXeusAbilitySystemComponent* Component)
+{
+	DirtyComponents.Remove(Component);
+
+	TArray<int32> auraIds;
+	if (!Memberships.RemoveAndCopyValue(Component, auraIds))
+		return;
+
+	// Component is leaving the world, its effects are removed by itself
+	for (const int32 auraId : auraIds)
+		if (FXeusAura* aura = Auras.Find(auraId))
+			aura->Members.Remove(Component);
+}
+
+void UXeusAuraSubsystem::OnAttachTransformUpdated(USceneComponent* Root, EUpdateTransformFlags Flags,
+                                                  ETeleportType Teleport, int32 AuraId)
+{
+	if (Auras.Contains(AuraId))
+		DirtyAuras.Add(AuraId);
+}
+
+bool UXeusAuraSubsystem::UpdateAuraCells(int32 AuraId, FXeusAura& Aura)
+{
+	RemoveAuraCells(AuraId, Aura);
+
+	Aura.WorldShape = Aura.Shape;
+	if (AttachedAuras.Contains(AuraId))
+	{
+		// Offset must not become world location when attached component is destroyed
+		const USceneComponent* attach = Aura.Attach.Get();
+		if (!IsValid(attach))
+			return false;
+		Aura.WorldShape.Center += attach->GetComponentLocation();
+	}
+
+	const FBox bounds = Aura.WorldShape.GetBounds();
+	const FIntPoint minCell = UXeusAbilityQuerySubsystem::GetCell(bounds.Min);
+	const FIntPoint maxCell = UXeusAbilityQuerySubsystem::GetCell(bounds.Max);
+	for (int32 x = minCell.X; x <= maxCell.X; ++x)
+	{
+		for (int32 y = minCell.Y; y <= maxCell.Y; ++y)
+		{
+			const FIntPoint cell(x, y);
+			Aura.Cells.Add(cell);
+			AuraCells.FindOrAdd(cell).Add(AuraId);
+		}
+	}
+	return true;
+}
+
+void UXeusAuraSubsystem::RemoveDetachedAuras()
+{
+	TArray<int32> detached;
+	for (const int32 auraId : AttachedAuras)
+	{
+		const FXeusAura* aura = Auras.Find(auraId);
+		if (!aura || !IsValid(aura->Attach.Get()))
+			detached.Add(auraId);
+	}
+
+	for (const int32 auraId : detached)
+		RemoveAura(auraId);
+}
+
+void UXeusAuraSubsystem::RemoveAuraCells(int32 AuraId, FXeusAura& Aura)
+{
+	for (const FIntPoint& cell : Aura.Cells)
+	{
+		if (TArray<int32>* auraIds = AuraCells.Find(cell))
+		{
+			auraIds->RemoveSingleSwap(AuraId);
+			if (auraIds->Num() == 0)
+				AuraCells.Remove(cell);
+		}
+	}
+	Aura.Cells.Reset();
+}
+
+void UXeusAuraSubsystem::Enter(int32 AuraId, UXeusAbilitySystemComponent* Component)
+{
+	const FXeusAura* aura = Auras.Find(AuraId);
+	if (!aura || !IsValid(Component))
+		return;
+
+	// Component stays member even if it resisted effect, so it is not applied again every frame
+	FXeusAuraMember member;
+	UObject* source = aura->Source.Get();
+	const float now = static_cast<float>(Component->GetEffectTime());
+	if (UXeusEffect* effect = Component->AddEffectFromSource(aura->EffectClass, source))
+	{
+		member.Effect = effect;
+		member.Serial = effect->GetRollbackSerial();
+		// New stack is the newest one, rejected stack leaves older stack there
+		const int32 stackCount = effect->GetStackCount();
+		if (effect->GetIsStackable() && stackCount > 0)
+		{
+			const FXeusEffectStack stack = effect->GetStack(stackCount - 1);
+			member.bHasStack = stack.Source.Get() == source && stack.ApplyTime == now;
+			member.Stack = stack;
+		}
+	}
+
+	// Started effect can add or remove auras
+	FXeusAura* addedTo = Auras.Find(AuraId);
+	if (!addedTo)
+		return;
+	addedTo->Members.Add(Component, member);
+	Memberships.FindOrAdd(Component).Add(AuraId);
+}
+
+void UXeusAuraSubsystem::Leave(int32 AuraId, FXeusAura& Aura, UXeusAbilitySystemComponent* Component)
+{
+	FXeusAuraMember member;
+	if (!Aura.Members.RemoveAndCopyValue(Component, member))
+		return;
+
+	if (TArray<int32>* auraIds = Memberships.Find(Component))
+	{
+		auraIds->RemoveSingleSwap(AuraId);
+		if (auraIds->Num() == 0)
+			Memberships.Remove(Component);
+	}
+
+	// Effect could already end or its pooled instance could be reused
+	UXeusEffect* effect = member.Effect.Get();
+	if (!effect || effect->GetAbilitySystem() != Component || effect->GetRollbackSerial() != member.Serial)
+		return;
+
+	// Other auras and effects can add stacks with same source
+	if (effect->GetIsStackable())
+	{
+		if (member.bHasStack)
+			effect->RemoveStack(member.Stack);
+	}
+	else
+		Component->StopEffectInstance(effect);
+}
+
+void UXeusAuraSubsystem::UpdateComponent(UXeusAbilitySystemComponent* Component)
+{
+	UXeusAbilityQuerySubsystem* querySubsystem = GetWorld()->GetSubsystem<UXeusAbilityQuerySubsystem>();
+	FVector location;
+	if (!IsValid(Component) || !querySubsystem || !querySubsystem->GetComponentLocation(Component, location))
+		return;
+
+	// Only auras near component and auras it is already inside are checked
+	CandidatesScratch.Reset();
+	if (const TArray<int32>* auraIds = AuraCells.Find(UXeusAbilityQuerySubsystem::GetCell(location)))
+		CandidatesScratch.Append(*auraIds);
+	if (const TArray<int32>* auraIds = Memberships.Find(Component))
+		for (const int32 auraId : *auraIds)
+			CandidatesScratch.AddUnique(auraId);
+
+	// Applied effects can move components, so candidates are copied
+	const TArray<int32> candidates = CandidatesScratch;
+	for (const int32 auraId : candidates)
+	{
+		FXeusAura* aura = Auras.Find(auraId);
+		if (!aura)
+			continue;
+
+		const bool bInside = aura->WorldShape.Contains(location);
+		const bool bMember = aura->Members.Contains(Component);
+		if (bInside && !bMember)
+			Enter(auraId, Component);
+		else if (!bInside && bMember)
+			Leave(auraId, *aura, Component);
+	}
+}
+
+void UXeusAuraSubsystem::UpdateAura(int32 AuraId)
+{
+	UXeusAbilityQuerySubsystem* querySubsystem = GetWorld()->GetSubsystem<UXeusAbilityQuerySubsystem>();
+	FXeusAura* aura = Auras.Find(AuraId);
+	if (!aura || !querySubsystem)
+		return;
+
+	if (!UpdateAuraCells(AuraId, *aura))
+	{
+		RemoveAura(AuraId);
+		return;
+	}
+	querySubsystem->GetComponentsInShape(aura->WorldShape, TargetsScratch);
+	const TSet<UXeusAbilitySystemComponent*> inside(TargetsScratch);
+
+	TArray<UXeusAbilitySystemComponent*> left;
+	for (const auto& pair : aura->Members)
+		if (!inside.Contains(pair.Key))
+			left.Add(pair.Key);
+
+	for (UXeusAbilitySystemComponent* component : left)
+		if ((aura = Auras.Find(AuraId)) != nullptr)
+			Leave(AuraId, *aura, component);
+
+	for (UXeusAbilitySystemComponent* component : inside)
+		if ((aura = Auras.Find(AuraId)) != nullptr && !aura->Members.Contains(component))
+			Enter(AuraId, component);
+}
+
+void UXeusAuraSubsystem::UpdateAuras()
+{
+	UXeusAbilityQuerySubsystem* querySubsystem = GetWorld()->GetSubsystem<UXeusAbilityQuerySubsystem>();
+	if (!querySubsystem)
+		return;
+
+	// Destroyed attached components do not move anymore, so they are checked every update
+	if (AttachedAuras.Num() > 0)
+		RemoveDetachedAuras();
+
+	// Moves components in spatial hash and marks them dirty
+	querySubsystem->FlushMovers();
+
+	if (DirtyAuras.Num() > 0)
+	{
+		const TSet<int32> auraIds = MoveTemp(DirtyAuras);
+		DirtyAuras.Reset();
+		for (const int32 auraId : auraIds)
+			UpdateAura(auraId);
+	}
+
+	if (DirtyComponents.Num() > 0)
+	{
+		const TSet<UXeusAbilitySystemComponent*> components = MoveTemp(DirtyComponents);
+		DirtyComponents.Reset();
+		for (UXeusAbilitySystemComponent* component : components)
+			UpdateComponent(component);
+	}
+}
+
+#pragma endregion
+
+#pragma region Auras
+
+int32 UXeusAuraSubsystem::AddAura(const FXeusAreaShape& Shape, TSubclassOf<UXeusEffect> EffectClass,
+                                  UObject* Source, USceneComponent* AttachTo)
+{
+	if (!EffectClass || EffectClass->HasAnyClassFlags(CLASS_Abstract))
+		return INDEX_NONE;
+
+	const int32 auraId = ++LastAuraId;
+	FXeusAura& aura = Auras.Add(auraId);
+	aura.Shape = Shape;
+	aura.EffectClass = EffectClass;
+	aura.Source = Source;
+	aura.Attach = AttachTo;
+	if (AttachTo)
+	{
+		aura.TransformHandle = AttachTo->TransformUpdated.AddUObject(
+			this, &UXeusAuraSubsystem::OnAttachTransformUpdated, auraId);
+		AttachedAuras.Add(auraId);
+	}
+
+	// Members are collected on next update
+	DirtyAuras.Add(auraId);
+	return auraId;
+}
+
+bool UXeusAuraSubsystem::RemoveAura(int32 AuraId)
+{
+	FXeusAura* aura = Auras.Find(AuraId);
+	if (!aura)
+		return false;
+
+	if (USceneComponent* attach = aura->Attach.Get())
+		attach->TransformUpdated.Remove(aura->TransformHandle);
+	RemoveAuraCells(AuraId, *aura);
+	DirtyAuras.Remove(AuraId);
+	AttachedAuras.Remove(AuraId);
+
+	TArray<UXeusAbilitySystemComponent*> members;
+	aura->Members.GenerateKeyArray(members);
+	for (UXeusAbilitySystemComponent* component : members)
+		if ((aura = Auras.Find(AuraId)) != nullptr)
+			Leave(AuraId, *aura, component);
+
+	Auras.Remove(AuraId);
+	return true;
+}
+
+void UXeusAuraSubsystem::SetAuraShape(int32 AuraId, const FXeusAreaShape& Shape)
+{
+	if (FXeusAura* aura = Auras.Find(AuraId))
+	{
+		aura->Shape = Shape;
+		DirtyAuras.Add(AuraId);
+	}
+}
+
+bool UXeusAuraSubsystem::IsInAura(int32 AuraId, UXeusAbilitySystemComponent* Component) const
+{
+	const FXeusAura* aura = Auras.Find(AuraId);
+	return aura && aura->Members.Contains(Component);
+}
+
+int32 UXeusAuraSubsystem::GetAuraMemberCount(int32 AuraId) const
+{
+	const FXeusAura* aura = Auras.Find(AuraId);
+	return aura ? aura->Members.Num() : 0;
+}
+
+#pragma endregion
@@ -0,0 +1,113 @@
+﻿// Developed by OIC
+
+#include "Subsystems/XeusEffectIconSubsystem.h"
+
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/Texture2D.h"
+
+UXeusEffectIconSubsystem::UXeusEffectIconSubsystem()
+{
+	CacheBudgetMB = 16.0f;
+	CacheBytes = 0;
+}
+
+void UXeusEffectIconSubsystem::Deinitialize()
+{
+	for (const auto& pair : Icons)
+		if (pair.Value.Handle.IsValid())
+			pair.Value.Handle->ReleaseHandle();
+	Icons.Empty();
+	UnusedIcons.Empty();
+	CacheBytes = 0;
+	Super::Deinitialize();
+}
+
+void UXeusEffectIconSubsystem::AcquireIcon(const FSoftObjectPath& Path)
+{
+	if (Path.IsNull())
+		return;
+
+	FXeusEffectIconStreaming* streaming = Icons.Find(Path);
+	if (!streaming)
+	{
+		// Callback can be executed immediately if icon is already loaded
+		Icons.Add(Path);
+		TSharedPtr<FStreamableHandle> handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+			Path, FStreamableDelegate::CreateUObject(this, &UXeusEffectIconSubsystem::OnIconLoaded, Path));
+		streaming = Icons.Find(Path);
+		streaming->Handle = handle;
+	}
+	else if (streaming->RefCount == 0)
+	{
+		UnusedIcons.RemoveSingle(Path);
+	}
+
+	++streaming->RefCount;
+}
+
+void UXeusEffectIconSubsystem::ReleaseIcon(const FSoftObjectPath& Path)
+{
+	FXeusEffectIconStreaming* streaming = Icons.Find(Path);
+	if (!streaming || streaming->RefCount == 0)
+		return;
+
+	if (--streaming->RefCount == 0)
+	{
+		UnusedIcons.Add(Path);
+		TrimCache();
+	}
+}
+
+void UXeusEffectIconSubsystem::OnIconLoaded(FSoftObjectPath Path)
+{
+	FXeusEffectIconStreaming* streaming = Icons.Find(Path);
+	if (!streaming || streaming->Bytes > 0)
+		return;
+
+	if (const UTexture2D* texture = Cast<UTexture2D>(Path.ResolveObject()))
+	{
+		streaming->Bytes = texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+		CacheBytes += streaming->Bytes;
+		TrimCache();
+	}
+}
+
+void UXeusEffectIconSubsystem::TrimCache()
+{
+	const int64 budget = static_cast<int64>(CacheBudgetMB * 1024.0f * 1024.0f);
+	int32 evicted = 0;
+	while (CacheBytes > budget && evicted < UnusedIcons.Num())
+	{
+		FXeusEffectIconStreaming streaming;
+		if (Icons.RemoveAndCopyValue(UnusedIcons[evicted++], streaming))
+		{
+			CacheBytes -= streaming.Bytes;
+			if (streaming.Handle.IsValid())
+				streaming.Handle->ReleaseHandle();
+		}
+	}
+	UnusedIcons.RemoveAt(0, evicted);
+}
+
+bool UXeusEffectIconSubsystem::IsIconLoaded(const TSoftObjectPtr<UTexture2D>& Icon) const
+{
+	const FXeusEffectIconStreaming* streaming = Icons.Find(Icon.ToSoftObjectPath());
+	return streaming && streaming->Handle.IsValid() && streaming->Handle->HasLoadCompleted();
+}
+
+float UXeusEffectIconSubsystem::GetCacheSizeMB() const
+{
+	return static_cast<float>(CacheBytes) / (1024.0f * 1024.0f);
+}
+
+float UXeusEffectIconSubsystem::GetCacheBudgetMB() const
+{
+	return CacheBudgetMB;
+}
+
+void UXeusEffectIconSubsystem::SetCacheBudgetMB(float InBudgetMB)
+{
+	CacheBudgetMB = FMath::Max(InBudgetMB, 0.0f);
+	TrimCache();
+}
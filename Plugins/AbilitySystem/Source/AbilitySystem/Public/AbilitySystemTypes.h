@@ -1,21 +1,12 @@
 ﻿#pragma once
 #include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
 #include "AbilitySystemTypes.generated.h"
 
 class UXeusEffect;
 class UXeusAttribute;
+class AActor;
 
-// Deprecated
-// Used for dynamic initialization of any effect
-USTRUCT()
-struct FXeusEffectSettings
-{
-	GENERATED_BODY()
-public:
-	
-};
-
-// Deprecated
 // Used for dynamic effect modifiers
 USTRUCT(BlueprintType)
 struct FXeusEffectModifier
@@ -32,6 +23,200 @@ public:
 	float Value;
 };
 
+// Parameters of one application of effect, used instead of subclass per value
+// Only enabled overrides are applied, everything else is taken from class defaults
+USTRUCT(BlueprintType)
+struct FXeusEffectSettings
+{
+	GENERATED_BODY()
+public:
+	FXeusEffectSettings();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(InlineEditConditionToggle))
+	bool bOverrideMagnitude;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(InlineEditConditionToggle))
+	bool bOverrideDuration;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(InlineEditConditionToggle))
+	bool bOverridePeriod;
+
+	// Amount of work (periodic heal/damage value, progress amount for 1 tick)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bOverrideMagnitude"))
+	float Magnitude;
+
+	// Duration in seconds
+	// Progress effects use it as NeedProgress, clamped to 1 like NeedProgress itself
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bOverrideDuration", ClampMin=0.001))
+	float Duration;
+
+	// Tick rate of periodic and progress effects
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bOverridePeriod", ClampMin=0.001))
+	float Period;
+
+	// Modifiers with same id replace modifiers of class, others are added
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FXeusEffectModifier> Modifiers;
+};
+
+// What happens with duration of stackable effect when new stack is added
+UENUM(BlueprintType)
+enum class EXeusStackDurationPolicy : uint8
+{
+	// Duration is not changed
+	None,
+	// Duration starts from the beginning
+	Refresh,
+	// Base duration is added to remaining duration
+	Extend
+};
+
+// How stacks of stackable effect are counted by sources
+UENUM(BlueprintType)
+enum class EXeusStackSourcePolicy : uint8
+{
+	// Every application adds new stack
+	Aggregate,
+	// One stack per source, application from the same source refreshes its stack
+	PerSource
+};
+
+// What happens when stackable effect already has max stacks
+UENUM(BlueprintType)
+enum class EXeusStackOverflowPolicy : uint8
+{
+	// New stack is rejected
+	Reject,
+	// Oldest stack is replaced with new one
+	ReplaceOldest
+};
+
+// Why effect class was rejected before creation
+UENUM(BlueprintType)
+enum class EXeusEffectRejectReason : uint8
+{
+	// Effect can be applied
+	None,
+	// Component is immune to effect class or its parent class
+	Immune,
+	// Component is immune to one of granted tags of effect
+	ImmuneTag,
+	// One of granted tags of effect is blocked by active effect
+	Blocked,
+	// Rejected by user filter
+	Filter,
+	MAX UMETA(Hidden)
+};
+
+// Data of one stack of stackable effect
+USTRUCT(BlueprintType)
+struct FXeusEffectStack
+{
+	GENERATED_BODY()
+public:
+	FXeusEffectStack();
+	FXeusEffectStack(UObject* InSource, float InApplyTime);
+
+	// Object that applied this stack (can be null)
+	UPROPERTY(BlueprintReadOnly)
+	TWeakObjectPtr<UObject> Source;
+
+	// Effect time of owning component when stack was applied
+	UPROPERTY(BlueprintReadOnly)
+	float ApplyTime;
+};
+
+// Who applied effect, used for damage attribution and removal of caster effects
+USTRUCT(BlueprintType)
+struct FXeusEffectContext
+{
+	GENERATED_BODY()
+public:
+	FXeusEffectContext();
+	FXeusEffectContext(AActor* InInstigator, UObject* InSource);
+
+	// Actor responsible for effect (caster, shooter etc..) (can be null)
+	UPROPERTY(BlueprintReadWrite)
+	TWeakObjectPtr<AActor> Instigator;
+
+	// Object that applied effect (ability, projectile, aura etc..) (can be null)
+	UPROPERTY(BlueprintReadWrite)
+	TWeakObjectPtr<UObject> Source;
+};
+
+// Reference to active effect of ability system component
+// Becomes invalid when effect is removed, even if its slot is reused by another effect
+// Handle is resolved only by component that issued it
+USTRUCT(BlueprintType)
+struct FXeusEffectHandle
+{
+	GENERATED_BODY()
+public:
+	FXeusEffectHandle();
+	FXeusEffectHandle(int32 InIndex, int32 InGeneration, int32 InOwner);
+
+	// Index of slot in component
+	UPROPERTY(BlueprintReadOnly)
+	int32 Index;
+
+	// Generation of slot when effect was added
+	UPROPERTY(BlueprintReadOnly)
+	int32 Generation;
+
+	// Id of component that issued handle (0 for invalid handle)
+	UPROPERTY(BlueprintReadOnly)
+	int32 Owner;
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	void Invalidate() { Index = INDEX_NONE; Generation = 0; Owner = 0; }
+
+	bool operator==(const FXeusEffectHandle& Other) const
+	{
+		return Index == Other.Index && Generation == Other.Generation && Owner == Other.Owner;
+	}
+
+	bool operator!=(const FXeusEffectHandle& Other) const { return !(*this == Other); }
+
+	friend uint32 GetTypeHash(const FXeusEffectHandle& Handle)
+	{
+		return HashCombine(HashCombine(::GetTypeHash(Handle.Index), ::GetTypeHash(Handle.Generation)),
+		                   ::GetTypeHash(Handle.Owner));
+	}
+};
+
+// Handle of timer on effect clock of ability system component
+struct FXeusEffectTimerHandle
+{
+	uint64 Id = 0;
+
+	bool IsValid() const { return Id != 0; }
+	void Invalidate() { Id = 0; }
+};
+
+// Display name and short id of effect or attribute class
+// Resolved once per class and kept in static cache, instances do not store it
+struct FXeusClassDisplayName
+{
+	FString Name;
+	FText Text;
+	FName Id;
+
+	void Resolve(const UClass* InClass, const FText& CustomText)
+	{
+		Name = InClass->GetName();
+		// Blueprint classes end with _C
+		FString name = Name;
+		name.RemoveFromEnd(TEXT("_C"));
+		Id = FName(*name);
+		Text = CustomText.IsEmpty()
+			       ? FText::AsCultureInvariant(FName::NameToDisplayString(name, false))
+			       : CustomText;
+	}
+
+	// Get cached name of class, resolve it on first call (game thread only)
+	ABILITYSYSTEM_API static const FXeusClassDisplayName& Find(const UClass* InClass, const FText& CustomText);
+};
+
 // Compact data about attribute
 // Can be used in widgets
 USTRUCT(BlueprintType)
@@ -46,6 +231,11 @@ struct FAttributeData
 	float Value;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float MaxValue;
+	// Localized name for HUD display
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FText DisplayText;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName Id;
 };
 
 // Compact data about effect
@@ -59,6 +249,11 @@ public:
 	UXeusEffect* Ref;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FString DisplayName;
+	// Localized name for HUD display
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FText DisplayText;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName Id;
 };
 
 // Service enum for the function of changing the attribute value
@@ -71,7 +266,6 @@ enum class EAttributeModifyType : uint8
 	Remove
 };
 
-// Deprecated
 // Used for attributes multipliers
 UENUM(BlueprintType)
 enum class EAttributeMultiplierType : uint8
@@ -81,10 +275,10 @@ enum class EAttributeMultiplierType : uint8
 	Remove,
 	Get,
 	MaxValue,
-	MinValue
+	MinValue,
+	MAX UMETA(Hidden)
 };
 
-// Deprecated
 // Dynamic attribute multiplier
 // (Can change behaviour of some function (add, remove, get)
 USTRUCT(BlueprintType)
@@ -108,3 +302,107 @@ public:
 	bool HasSameValue(const FAttributeMultiplier& Other) const;
 	bool HasSameType(const FAttributeMultiplier& Other) const;
 };
+
+// Cached product of attribute multipliers of one type
+// Recalculated from multipliers of attribute only when dirty
+struct FAttributeMultiplierBucket
+{
+	FAttributeMultiplierBucket();
+
+	float Product;
+	bool bProductDirty;
+
+	// Account new multiplier without recalculation
+	void Add(float InValue);
+
+	// Reset to empty bucket
+	void Reset();
+};
+
+// Declarative link from effect modifiers to attribute
+// Total modifier of effect will be applied as multiplier of this attribute
+USTRUCT(BlueprintType)
+struct FXeusEffectAttributeLink
+{
+	GENERATED_BODY()
+public:
+	FXeusEffectAttributeLink();
+	FXeusEffectAttributeLink(TSubclassOf<UXeusAttribute> InAttribute, EAttributeMultiplierType InType);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<UXeusAttribute> Attribute;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EAttributeMultiplierType Type;
+};
+
+// Compact binary state of ability system component (attributes, multipliers and active effects)
+// Data is one flat buffer, so copying snapshot is a single memcpy
+USTRUCT(BlueprintType)
+struct FXeusAbilitySystemSnapshot
+{
+	GENERATED_BODY()
+public:
+	// Written at the beginning of Data to detect garbage
+	static constexpr uint32 Magic = 0x53534158; // XASS
+
+	// Increment when layout of snapshot changes, older layouts are still read by RestoreSnapshot
+	// 1 - table of class paths, attribute and effect records
+	// 2 - table of class packages and names, table of runtime objects, stack sources in effect records
+	// 3 - instigator and source of effect context in effect records
+	// 4 - applied settings in effect records
+	static constexpr int32 CurrentVersion = 4;
+
+	// Version of layout Data was written with
+	UPROPERTY(SaveGame)
+	int32 Version = 0;
+
+	// Serialized state
+	UPROPERTY(SaveGame)
+	TArray<uint8> Data;
+
+	bool IsValid() const { return Version > 0 && Data.Num() > 0; }
+};
+
+// Shape of area for spatial queries and area effects
+UENUM(BlueprintType)
+enum class EXeusAreaShapeType : uint8
+{
+	Sphere,
+	// Vertical cylinder, half height is Extent.Z
+	Cylinder,
+	Box
+};
+
+// Area in world space for spatial queries and area effects
+USTRUCT(BlueprintType)
+struct FXeusAreaShape
+{
+	GENERATED_BODY()
+public:
+	FXeusAreaShape();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EXeusAreaShapeType Type;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Center;
+
+	// Radius of sphere and cylinder
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Radius;
+
+	// Half size of box, Z is half height of cylinder
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector Extent;
+
+	// Rotation of box
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FRotator Rotation;
+
+	// Check if point is inside area
+	bool Contains(const FVector& Point) const;
+
+	// Axis aligned bounds of area
+	FBox GetBounds() const;
+};
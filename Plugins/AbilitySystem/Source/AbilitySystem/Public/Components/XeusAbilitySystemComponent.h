@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 
 #include "Components/ActorComponent.h"
+#include "GameplayTagContainer.h"
 #include "Data/XeusAttribute.h"
 #include "Data/XeusEffect.h"
 
@@ -12,6 +13,14 @@
 
 class UXeusAbilitySystemComponent;
 class UXeusAttribute;
+class UXeusDerivedAttribute;
+class UXeusAttributeSetDefinition;
+class UXeusEffectBundle;
+class UXeusEffectSpec;
+class UXeusAbilitySystemViewModel;
+class UXeusAbilityQuerySubsystem;
+class UXeusEffectIconSubsystem;
+struct FStreamableHandle;
 class AXeusAbility;
 class UXeusEffect;
 
@@ -31,6 +40,233 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FAbilitySystemXeusEffectActionDeleg
                                              UXeusAbilitySystemComponent*, AbilitySystemComponent,
                                              UXeusEffect*, Effect);
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FAbilitySystemStepDelegate,
+                                               UXeusAbilitySystemComponent*, AbilitySystemComponent,
+                                               int32, StepIndex,
+                                               int32, StateHash);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FAbilitySystemEffectRejectedDelegate,
+                                              UXeusAbilitySystemComponent*, AbilitySystemComponent,
+                                              TSubclassOf<UXeusEffect>, EffectClass,
+                                              UObject*, Source,
+                                              EXeusEffectRejectReason, Reason);
+
+/**
+ * Native filter of incoming effects
+ * Returns false to reject effect class before it is created
+ */
+DECLARE_DELEGATE_RetVal_ThreeParams(bool, FXeusEffectFilterDelegate,
+                                    const UXeusAbilitySystemComponent*, TSubclassOf<UXeusEffect>, UObject*);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FAbilitySystemTagCountDelegate,
+                                               UXeusAbilitySystemComponent*, AbilitySystemComponent,
+                                               FGameplayTag, Tag,
+                                               int32, Count);
+
+/**
+ * Cached aggregate of effect modifiers linked to one attribute class
+ * @see UXeusEffect::ModifierTargets
+ */
+struct FXeusModifierAggregate
+{
+	/**
+	 * @brief Attribute instance that receives aggregated multipliers
+	 * Can be null while component has no attribute of linked class
+	 */
+	UXeusAttribute* Attribute = nullptr;
+
+	/**
+	 * @brief Linked effects and multiplier type they affect
+	 */
+	TArray<TPair<UXeusEffect*, EAttributeMultiplierType>> Links;
+};
+
+/**
+ * Slot of effect in ability system component
+ * @see FXeusEffectHandle
+ */
+struct FXeusEffectSlot
+{
+	/**
+	 * @brief Effect in slot (null if slot is free)
+	 */
+	UXeusEffect* Effect = nullptr;
+
+	/**
+	 * @brief Incremented every time slot is freed, so old handles become invalid
+	 */
+	int32 Generation = 1;
+};
+
+/**
+ * Timer on effect clock of ability system component
+ */
+struct FXeusEffectTimer
+{
+	/**
+	 * @brief Function to call
+	 */
+	FSimpleDelegate Callback;
+
+	/**
+	 * @brief Effect time of next call
+	 */
+	double FireTime = 0.0;
+
+	/**
+	 * @brief Remaining time when timer was paused
+	 */
+	double Remaining = 0.0;
+
+	/**
+	 * @brief Loop rate
+	 */
+	float Rate = 0.0f;
+
+	/**
+	 * @brief Is timer looping
+	 */
+	bool bLoop = false;
+
+	/**
+	 * @brief Is timer paused by its owner
+	 */
+	bool bPaused = false;
+
+	/**
+	 * @brief Incremented on every reschedule, outdated heap entries are skipped
+	 */
+	uint32 Version = 0;
+};
+
+/**
+ * Entry of timer queue
+ */
+struct FXeusEffectTimerEntry
+{
+	double FireTime;
+	uint64 Id;
+	uint32 Version;
+
+	/**
+	 * @brief Earlier timers go first, timers with the same time go in order of creation
+	 */
+	bool operator<(const FXeusEffectTimerEntry& Other) const
+	{
+		return FireTime < Other.FireTime || (FireTime == Other.FireTime && Id < Other.Id);
+	}
+};
+
+/**
+ * Saved state of attribute or effect in rollback history
+ */
+struct FXeusRollbackObjectState
+{
+	/**
+	 * @brief Rollback serial of effect (0 for attributes)
+	 */
+	uint32 Serial = 0;
+
+	/**
+	 * @brief Class of object
+	 */
+	UClass* Class = nullptr;
+
+	/**
+	 * @brief Index of object in Effects or Attributes array
+	 */
+	int32 Order = INDEX_NONE;
+
+	/**
+	 * @brief Serialized state
+	 * @see UXeusEffect::SerializeState
+	 */
+	TArray<uint8> State;
+
+	/**
+	 * @brief Sources of effect stacks (not part of serialized state)
+	 */
+	TArray<TWeakObjectPtr<UObject>> StackSources;
+
+	/**
+	 * @brief Who applied effect (not part of serialized state)
+	 */
+	FXeusEffectContext Context;
+
+	/**
+	 * @brief Key of instigator, kept when instigator is destroyed
+	 * @see UXeusEffect::GetInstigatorKey
+	 */
+	FObjectKey InstigatorKey;
+
+	/**
+	 * @brief Settings effect was applied with (not part of serialized state)
+	 * @see UXeusEffect::GetAppliedSettings
+	 */
+	FXeusEffectSettings Settings;
+};
+
+/**
+ * Changes made by one simulation step, stored as data needed to undo them
+ */
+struct FXeusRollbackFrame
+{
+	/**
+	 * @brief Step that made changes
+	 */
+	int32 Step = 0;
+
+	/**
+	 * @brief Effect time before step
+	 */
+	double EffectTime = 0.0;
+
+	/**
+	 * @brief Previous state of attributes changed by step
+	 */
+	TArray<FXeusRollbackObjectState> ChangedAttributes;
+
+	/**
+	 * @brief Last state of attributes removed by step
+	 */
+	TArray<FXeusRollbackObjectState> RemovedAttributes;
+
+	/**
+	 * @brief Classes of attributes added by step
+	 */
+	TArray<UClass*> AddedAttributes;
+
+	/**
+	 * @brief Previous state of effects changed by step
+	 */
+	TArray<FXeusRollbackObjectState> ChangedEffects;
+
+	/**
+	 * @brief Last state of effects removed by step
+	 */
+	TArray<FXeusRollbackObjectState> RemovedEffects;
+
+	/**
+	 * @brief Serials of effects added by step
+	 */
+	TArray<uint32> AddedEffects;
+};
+
+/**
+ * Streaming handles of pre-loaded effect bundle
+ */
+struct FXeusEffectBundleStreaming
+{
+	/**
+	 * @brief Handle of effect classes
+	 */
+	TSharedPtr<FStreamableHandle> ClassesHandle;
+
+	/**
+	 * @brief Handle of icons of displayable effects (after classes are loaded)
+	 */
+	TSharedPtr<FStreamableHandle> IconsHandle;
+};
 
 /**
  * Main ability system component
@@ -58,310 +294,1431 @@ protected:
 	UPROPERTY(BlueprintReadOnly)
 	TArray<UXeusEffect*> Effects;
 
-protected:
-	// Called when the game starts
-	virtual void BeginPlay() override;
+	/**
+	 * @brief Aggregated effect modifiers by target attribute class
+	 * Updated when effects are added or removed and when their modifiers change
+	 */
+	TMap<UClass*, FXeusModifierAggregate> ModifierAggregates;
 
+	/**
+	 * @brief Active stackable effects by their exact class
+	 * There is only one instance of every stackable class,
+	 * child classes are matched by scanning this map
+	 * @see StackEffect
+	 */
+	TMap<UClass*, UXeusEffect*> StackableEffects;
 
-	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	/**
+	 * @brief Number of active effects that grant tag
+	 * Parent tags are counted too, so Debuff is present while Debuff.Stun is granted
+	 */
+	TMap<FGameplayTag, int32> GrantedTagCounts;
 
-#pragma region Effects_Funcs
+	/**
+	 * @brief Number of active effects that block tag
+	 * @see UXeusEffect::BlockedTags
+	 */
+	TMap<FGameplayTag, int32> BlockedTagCounts;
 
 	/**
-	 * @brief Called at begin play to initialize all default effects
-	 * @see BeginPlay
-	 * @see InitialEffects
+	 * @brief Active effects by granted tag (and its parents)
 	 */
-	UFUNCTION()
-	void InitEffects();
+	TMap<FGameplayTag, TArray<UXeusEffect*>> EffectsByTag;
 
 	/**
-	 * @brief Called when some effect wants to be removed
-	 * It will notify all effects and call broadcast event
-	 * @param Effect 
+	 * @brief Active effects by key of their instigator
+	 * @see UXeusEffect::GetInstigatorKey
 	 */
-	UFUNCTION()
-	void Effect_NeedRemove(UXeusEffect* Effect);
+	TMap<FObjectKey, TArray<UXeusEffect*>> EffectsByInstigator;
 
 	/**
-	 * @brief Try to stack effect by class
-	 * @param InClass Effect class
-	 * @return Pointer to effect if stacked, nullptr otherwise 
+	 * @brief Slots referenced by effect handles
+	 * Slots are never removed, only reused
+	 * @see FXeusEffectHandle
 	 */
-	UFUNCTION()
-	UXeusEffect* StackEffect(TSubclassOf<UXeusEffect> InClass);
+	TArray<FXeusEffectSlot> EffectSlots;
 
 	/**
-	 * @brief Add new effect and NotifyBeginWork
-	 * @param InEffect Effect instance
+	 * @brief Indices of free slots
 	 */
-	UFUNCTION()
-	void PushEffect(UXeusEffect* InEffect);
+	TArray<int32> FreeEffectSlots;
 
 	/**
-	 * @brief Destroy effect by class and remove from container
-	 * Called when some effect wants to be removed
-	 * @param InClass Effect class
-	 * @return True if removed
+	 * @brief Unique id of component written to its handles, so handle of other component is not resolved here
 	 */
-	UFUNCTION()
-	bool RemoveEffect(TSubclassOf<UXeusEffect> InClass);
+	int32 EffectHandleOwner;
 
-#pragma endregion
-#pragma region Attributes_Funcs
+	/**
+	 * @brief Number of immunities to effect class (and its children)
+	 * @see AddEffectImmunity
+	 */
+	TMap<UClass*, int32> ImmuneClassCounts;
 
 	/**
-	 * @brief Called at begin play to initialize all default attributes
-	 * @see BeginPlay
-	 * @see InitialAttributes
+	 * @brief Number of immunities to granted tag (and its children)
+	 * @see AddImmunityTag
 	 */
-	UFUNCTION()
-	void InitAttributes();
+	TMap<FGameplayTag, int32> ImmuneTagCounts;
+
+	/**
+	 * @brief How many times each reject reason fired
+	 */
+	int32 RejectCounts[static_cast<int32>(EXeusEffectRejectReason::MAX)];
+
+	/**
+	 * @brief Derived attributes sorted by dependencies (inputs go before dependents)
+	 * Attributes that are part of dependency cycle are not included
+	 * @see RebuildDependencyGraph
+	 */
+	TArray<UXeusDerivedAttribute*> DerivedOrder;
+
+	/**
+	 * @brief Resolved inputs of derived attributes (same indices as DerivedOrder)
+	 */
+	TArray<TArray<UXeusAttribute*>> DerivedInputs;
+
+	/**
+	 * @brief Indices in DerivedOrder of attributes that depend on attribute
+	 */
+	TMap<UXeusAttribute*, TArray<int32>> DerivedDependents;
+
+	/**
+	 * @brief Derived attributes that need recalculation (same indices as DerivedOrder)
+	 */
+	TBitArray<> DirtyDerived;
+
+	/**
+	 * @brief True if any bit of DirtyDerived is set
+	 */
+	bool bHasDirtyDerived;
+
+	/**
+	 * @brief Current time of effect clock
+	 * Advanced every tick by scaled delta time unless effects are paused
+	 */
+	double EffectTime;
+
+	/**
+	 * @brief Is effect clock stopped
+	 * @see PauseAllEffects
+	 */
+	bool bEffectsPaused;
+
+	/**
+	 * @brief Scale of effect clock (slow motion, haste etc..)
+	 * Applied on top of world and actor time dilation
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="AbilitySystem|Effects", meta=(ClampMin=0.0))
+	float EffectTimeScale;
+
+	/**
+	 * @brief Effect clock advances only by fixed steps
+	 * Timers fire in order of (fire time, creation) and effects and attributes are iterated in insertion order,
+	 * so the same inputs give the same state on every machine
+	 * @see AdvanceFixedStep
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Deterministic")
+	bool bDeterministic;
+
+	/**
+	 * @brief Effect time of one simulation step
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Deterministic",
+		meta=(EditCondition="bDeterministic", ClampMin=0.001))
+	float FixedStep;
+
+	/**
+	 * @brief Run steps from tick by accumulated scaled delta time
+	 * Otherwise steps are only done by AdvanceFixedStep (lockstep, replays)
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Deterministic",
+		meta=(EditCondition="bDeterministic"))
+	bool bAutoStep;
+
+	/**
+	 * @brief Calculate state hash after every step
+	 * @see GetStateHash
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Deterministic",
+		meta=(EditCondition="bDeterministic"))
+	bool bHashSteps;
+
+	/**
+	 * @brief Count of simulated steps
+	 */
+	int32 StepIndex;
+
+	/**
+	 * @brief Delta time that is not simulated yet (auto step)
+	 */
+	double StepAccumulator;
+
+	/**
+	 * @brief State hash after last step
+	 */
+	uint32 StepStateHash;
+
+	/**
+	 * @brief Count of steps that can be rewound (0 disables history)
+	 * Memory is bounded by this count of frames
+	 * @see RewindTo
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Deterministic",
+		meta=(EditCondition="bDeterministic", ClampMin=0))
+	int32 HistoryLength;
+
+	/**
+	 * @brief Ring buffer of per-step changes (index is step % HistoryLength)
+	 */
+	TArray<FXeusRollbackFrame> RollbackFrames;
+
+	/**
+	 * @brief Count of valid frames in ring buffer
+	 */
+	int32 RollbackFrameCount;
+
+	/**
+	 * @brief State of attributes after last recorded step by attribute class
+	 * Class is used as key, so state of removed attribute is kept until step records its removal
+	 */
+	TMap<UClass*, FXeusRollbackObjectState> RollbackAttributeStates;
+
+	/**
+	 * @brief State of effects after last recorded step by serial
+	 */
+	TMap<uint32, FXeusRollbackObjectState> RollbackEffectStates;
+
+	/**
+	 * @brief Is baseline state captured
+	 */
+	bool bRollbackBaseline;
+
+	/**
+	 * @brief Is component resimulating steps after rewind
+	 */
+	bool bResimulating;
+
+	/**
+	 * @brief Last assigned rollback serial of effect
+	 */
+	uint32 LastEffectSerial;
+
+	/**
+	 * @brief Incremented on every change of state that is saved to snapshot
+	 * @see GetStateRevision
+	 */
+	uint32 StateRevision;
+
+	/**
+	 * @brief Timers of effects by id
+	 */
+	TMap<uint64, FXeusEffectTimer> EffectTimers;
+
+	/**
+	 * @brief Queue of timers sorted by fire time (binary heap)
+	 */
+	TArray<FXeusEffectTimerEntry> EffectTimerQueue;
+
+	/**
+	 * @brief Id of last created timer
+	 */
+	uint64 LastEffectTimerId;
+
+	/**
+	 * @brief Handle of soft initial attributes and effects that are being streamed
+	 */
+	TSharedPtr<FStreamableHandle> InitialClassesHandle;
+
+	/**
+	 * @brief Handle of snapshot classes that are being streamed before snapshot is restored
+	 * @see RestoreSnapshot
+	 */
+	TSharedPtr<FStreamableHandle> SnapshotClassesHandle;
+
+	/**
+	 * @brief Handles of effects that will be added when their class is loaded
+	 * @see AddEffectSoft
+	 */
+	TArray<TSharedPtr<FStreamableHandle>> PendingEffectLoads;
+
+	/**
+	 * @brief Streaming state of pre-loaded bundles
+	 * @see PreloadEffectBundle
+	 */
+	TMap<FPrimaryAssetId, FXeusEffectBundleStreaming> BundleStreaming;
+
+	/**
+	 * @brief True after initial attributes were added
+	 * Dependency graph is rebuilt on every attribute change after that
+	 */
+	bool bAttributesInitialized;
+
+	/**
+	 * @brief Query registries of world this component is registered in (null outside of play)
+	 * Notified when effects are added or removed and attribute values change
+	 */
+	UPROPERTY(Transient)
+	UXeusAbilityQuerySubsystem* QuerySubsystem;
+
+protected:
+	// Called when the game starts
+	virtual void BeginPlay() override;
+
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+#pragma region Effects_Funcs
+
+	/**
+	 * @brief Called at begin play to initialize all default effects
+	 * @see BeginPlay
+	 * @see InitialEffects
+	 */
+	UFUNCTION()
+	void InitEffects();
+
+	/**
+	 * @brief Called when some effect wants to be removed
+	 * It will notify all effects and call broadcast event
+	 * @param Effect 
+	 */
+	UFUNCTION()
+	void Effect_NeedRemove(UXeusEffect* Effect);
+
+	/**
+	 * @brief Try to stack effect by class
+	 * Stackable instance of InClass or its child is stacked, Stack() is called
+	 * even if new stack was rejected by max stacks
+	 * @param InClass Effect class
+	 * @param Source Object that applies stack (can be null)
+	 * @return Pointer to effect if stacked, nullptr otherwise 
+	 */
+	UFUNCTION()
+	UXeusEffect* StackEffect(TSubclassOf<UXeusEffect> InClass, UObject* Source = nullptr);
+
+	/**
+	 * @brief Add new effect and NotifyBeginWork
+	 * @param InEffect Effect instance
+	 */
+	UFUNCTION()
+	void PushEffect(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Add effect to container and indices without any notifications
+	 * @param InEffect Effect instance
+	 */
+	void LinkEffect(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Remove effect from container and indices and destroy it without any notifications
+	 * @param InEffect Effect instance
+	 */
+	void UnlinkEffect(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Put effect into free slot and give it handle
+	 * @param InEffect Effect instance
+	 */
+	void AllocateEffectHandle(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Free slot of effect, so its handle becomes invalid
+	 * @param InEffect Effect instance
+	 */
+	void ReleaseEffectHandle(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Create effect instance (taken from pool of area effect subsystem if effect is poolable)
+	 * @param InClass Effect class
+	 * @return New effect
+	 */
+	UXeusEffect* NewEffectInstance(TSubclassOf<UXeusEffect> InClass);
+
+	/**
+	 * @brief Destroy removed effect instance (or return it to pool if effect is poolable)
+	 * @param InEffect Removed effect
+	 */
+	void DestroyEffectInstance(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Compare state of attributes and effects with last recorded one and save changes of step
+	 * @param PreviousEffectTime Effect time before step
+	 */
+	void RecordRollbackFrame(double PreviousEffectTime);
+
+	/**
+	 * @brief Capture state of attributes and effects without recording a frame
+	 */
+	void CaptureRollbackBaseline();
+
+	/**
+	 * @brief Undo changes of one frame
+	 * @param Frame Recorded frame
+	 */
+	void UndoRollbackFrame(const FXeusRollbackFrame& Frame);
+
+	/**
+	 * @brief Drop history and baseline
+	 */
+	void ResetRollbackHistory();
+
+	/**
+	 * @brief Write snapshot record prefixed with its size
+	 * @param Ar Snapshot archive
+	 * @param Write Function that writes record
+	 */
+	static void WriteSizedRecord(FArchive& Ar, TFunctionRef<void(FArchive&)> Write);
+
+	/**
+	 * @brief Restore snapshot, optionally streaming its missing classes first
+	 * @param Snapshot Snapshot of component state
+	 * @param bFireStartEvents Broadcast OnEffectStartedWork and OnValueChanged for restored state
+	 * @param bFireEndEvents Broadcast OnEffectEndWork and EffectRemoving for replaced effects
+	 * @param bLoadMissingClasses Stream classes that are not loaded and restore when they are loaded
+	 * @return True if snapshot was valid
+	 */
+	bool RestoreSnapshotImpl(const FXeusAbilitySystemSnapshot& Snapshot, bool bFireStartEvents,
+	                         bool bFireEndEvents, bool bLoadMissingClasses);
+
+	/**
+	 * @brief Called when missing classes of snapshot are loaded
+	 * @param Snapshot Snapshot of component state
+	 * @param bFireStartEvents Broadcast start events for restored state
+	 * @param bFireEndEvents Broadcast end events for replaced effects
+	 */
+	void OnSnapshotClassesLoaded(FXeusAbilitySystemSnapshot Snapshot, bool bFireStartEvents, bool bFireEndEvents);
+
+	/**
+	 * @brief Destroy effect by class and remove from container
+	 * Called when some effect wants to be removed
+	 * @param InClass Effect class
+	 * @return True if removed
+	 */
+	UFUNCTION()
+	bool RemoveEffect(TSubclassOf<UXeusEffect> InClass);
+
+	/**
+	 * @brief Destroy effect instance and remove from container
+	 * @param Effect Effect instance
+	 * @return True if removed
+	 */
+	bool RemoveEffectInstance(UXeusEffect* Effect);
+
+	/**
+	 * @brief Start async streaming of soft initial attributes and effects
+	 * @see SoftInitialAttributes
+	 * @see SoftInitialEffects
+	 */
+	void RequestInitialClasses();
+
+	/**
+	 * @brief Called when soft initial classes are loaded to add attributes and effects
+	 */
+	void OnInitialClassesLoaded();
+
+	/**
+	 * @brief Called when class of pending effect is loaded
+	 * @param InClass Soft effect class
+	 * @see AddEffectSoft
+	 */
+	void OnSoftEffectLoaded(TSoftClassPtr<UXeusEffect> InClass);
+
+	/**
+	 * @brief Called when classes of bundle are loaded to stream icons
+	 * @param Bundle Effect bundle
+	 */
+	void OnBundleClassesLoaded(TWeakObjectPtr<UXeusEffectBundle> Bundle);
+
+	/**
+	 * @brief Cancel all pending async loads and release bundles
+	 */
+	void CancelStreaming();
+
+	/**
+	 * @brief Advance effect clock and fire due timers in order
+	 * @param DeltaTime Effect time delta
+	 */
+	void AdvanceEffectTime(double DeltaTime);
+
+	/**
+	 * @brief Simulate one fixed step: advance clock, fire timers, recalculate derived attributes
+	 */
+	void SimulateStep();
+
+	/**
+	 * @brief Add timer to queue with new version
+	 * @param Id Timer id
+	 * @param Timer Timer data
+	 */
+	void QueueEffectTimer(uint64 Id, FXeusEffectTimer& Timer);
+
+	/**
+	 * @brief Link modifiers of effect to aggregates of its target attributes
+	 * @param InEffect Effect instance
+	 * @see UXeusEffect::ModifierTargets
+	 */
+	void RegisterEffectModifiers(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Unlink modifiers of effect from aggregates of its target attributes
+	 * @param InEffect Effect instance
+	 */
+	void UnregisterEffectModifiers(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Recalculate product of one multiplier type and push it to attribute
+	 * @param Aggregate Aggregate of attribute
+	 * @param Type Multiplier type to recalculate
+	 */
+	void UpdateModifierAggregate(const FXeusModifierAggregate& Aggregate, EAttributeMultiplierType Type) const;
+
+	/**
+	 * @brief Called when total modifier of some linked effect changed
+	 * @param Effect Effect instance
+	 * @param Value New total modifier
+	 */
+	UFUNCTION()
+	void Effect_ModifierChanged(UXeusEffect* Effect, float Value);
+
+	/**
+	 * @brief Run filter stage for incoming effect class, count and broadcast rejection
+	 * @param InClass Effect class
+	 * @param Source Object that applies effect (can be null)
+	 * @return True if effect can be created
+	 */
+	bool FilterIncomingEffect(TSubclassOf<UXeusEffect> InClass, UObject* Source);
+
+	/**
+	 * @brief User rule of filter stage, called after immunity and block rules
+	 * @param InClass Effect class
+	 * @param Source Object that applies effect (can be null)
+	 * @return False to reject effect
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	bool CanApplyEffect(TSubclassOf<UXeusEffect> InClass, UObject* Source) const;
+
+	/**
+	 * @brief Add granted and blocked tags of effect to counters and index
+	 * @param InEffect Effect instance
+	 */
+	void RegisterEffectTags(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Remove granted and blocked tags of effect from counters and index
+	 * @param InEffect Effect instance
+	 */
+	void UnregisterEffectTags(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Get unique id of aggregated multiplier
+	 * @param Type Multiplier type
+	 * @return Id of multiplier in attribute
+	 */
+	static FName GetModifierAggregateId(EAttributeMultiplierType Type);
+
+#pragma endregion
+#pragma region Attributes_Funcs
+
+	/**
+	 * @brief Called at begin play to initialize all default attributes
+	 * @see BeginPlay
+	 * @see InitialAttributes
+	 */
+	UFUNCTION()
+	void InitAttributes();
+
+	/**
+	 * @brief Called when current value of any attribute changed to broadcast event
+	 * @param Attribute Attribute instance
+	 * @param Value New value of attribute
+	 */
+	UFUNCTION()
+	void ValueChangedHandle(UXeusAttribute* Attribute, float Value);
+
+	/**
+	 * @brief Called when min value of any attribute changed to broadcast event
+	 * @param Attribute Attribute instance
+	 * @param Value New min value of attribute
+	 */
+	UFUNCTION()
+	void MinValueChangedHandle(UXeusAttribute* Attribute, float Value);
+
+	/**
+	 * @brief Called when max value of any attribute changed to broadcast event
+	 * @param Attribute Attribute instance
+	 * @param Value New max value of attribute
+	 */
+	UFUNCTION()
+	void MaxValueChangedHandle(UXeusAttribute* Attribute, float Value);
+
+	/**
+	 * @brief Called when value of any attribute clamped to max value
+	 * @param Attribute Attribute instance
+	 */
+	UFUNCTION()
+	void MaxHandle(UXeusAttribute* Attribute);
+
+	/**
+	 * @brief Called when value of any attribute clamped to min value
+	 * @param Attribute Attribute instance
+	 */
+	UFUNCTION()
+	void MinHandle(UXeusAttribute* Attribute);
+
+	/**
+	 * @brief Called when multiplier of any attribute was added or changed
+	 * @param Attribute Attribute instance
+	 * @param UniqueId Multiplier id
+	 */
+	UFUNCTION()
+	void MultChangedHandle(UXeusAttribute* Attribute, FName UniqueId);
+
+	/**
+	 * @brief Called when multiplier of any attribute was removed
+	 * @param Attribute Attribute instance
+	 */
+	UFUNCTION()
+	void MultRemovedHandle(UXeusAttribute* Attribute);
+
+	/**
+	 * @brief Sort derived attributes by dependencies and resolve their inputs
+	 * Attributes that form a cycle are reported and excluded from recalculation
+	 */
+	void RebuildDependencyGraph();
+
+	/**
+	 * @brief Mark derived attributes that depend on attribute for recalculation
+	 * @param Attribute Changed attribute
+	 */
+	void MarkDependentsDirty(UXeusAttribute* Attribute);
+
+	/**
+	 * @brief Recalculate all dirty derived attributes in dependency order
+	 * Called once per frame
+	 */
+	void FlushDerivedAttributes();
+
+#pragma endregion
+
+public:
+	// Called every frame
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
+	                           FActorComponentTickFunction* ThisTickFunction) override;
+
+#pragma endregion
+#pragma region Effects
+
+protected:
+	/**
+	 * @brief Service function. Will be called at end play to clear effects memory
+	 * Do not call it directly
+	 */
+	UFUNCTION()
+	void RemoveAllEffects();
+
+	/**
+	 * @brief Destroy all effects without running their EndWork
+	 * @param bFireEndEvents Broadcast OnEffectEndWork and EffectRemoving for each effect
+	 */
+	void RemoveAllEffectsImpl(bool bFireEndEvents);
+
+public:
+	/**
+	 * @brief Initial effects that will be initialized from begin play
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Effects")
+	TArray<TSubclassOf<UXeusEffect>> InitialEffects;
+
+	/**
+	 * @brief Initial effects that will be streamed asynchronously and added when loaded
+	 * They are added after soft initial attributes
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Effects")
+	TArray<TSoftClassPtr<UXeusEffect>> SoftInitialEffects;
+
+	/**
+	 * @brief Effect classes (and their children) this component is immune to from begin play
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Effects")
+	TArray<TSubclassOf<UXeusEffect>> InitialImmunities;
+
+	/**
+	 * @brief Effects that grant any of these tags (or their children) are never applied
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Effects")
+	FGameplayTagContainer InitialImmunityTags;
+
+	/**
+	 * @brief Native user rule of filter stage
+	 * Called after immunity and block rules, before CanApplyEffect
+	 */
+	FXeusEffectFilterDelegate EffectFilter;
+
+	/**
+	 * @brief Check why effect class would be rejected, without creating it
+	 * Rules are checked from cheapest: class immunity, tag immunity, blocked tags, user filter
+	 * @param InClass Effect class
+	 * @param Source Object that applies effect (can be null)
+	 * @return Reject reason, None if effect can be applied
+	 */
+	UFUNCTION(BlueprintPure)
+	EXeusEffectRejectReason CheckEffectApplication(TSubclassOf<UXeusEffect> InClass, UObject* Source) const;
+
+	/**
+	 * @brief Make component immune to effect class and its children
+	 * Immunities are counted, every add needs its own remove
+	 * @param InClass Effect class
+	 */
+	UFUNCTION(BlueprintCallable)
+	void AddEffectImmunity(TSubclassOf<UXeusEffect> InClass);
+
+	/**
+	 * @brief Remove one immunity to effect class
+	 * @param InClass Effect class
+	 */
+	UFUNCTION(BlueprintCallable)
+	void RemoveEffectImmunity(TSubclassOf<UXeusEffect> InClass);
+
+	/**
+	 * @brief Check if component is immune to effect class (or its parent class)
+	 * @param InClass Effect class
+	 * @return True if immune
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsImmuneToEffect(TSubclassOf<UXeusEffect> InClass) const;
+
+	/**
+	 * @brief Make component immune to effects that grant tag (or its children)
+	 * Immunities are counted, every add needs its own remove
+	 * @param Tag Gameplay tag
+	 */
+	UFUNCTION(BlueprintCallable)
+	void AddImmunityTag(FGameplayTag Tag);
+
+	/**
+	 * @brief Remove one immunity to tag
+	 * @param Tag Gameplay tag
+	 */
+	UFUNCTION(BlueprintCallable)
+	void RemoveImmunityTag(FGameplayTag Tag);
+
+	/**
+	 * @brief Get how many times effects were rejected by reason
+	 * @param Reason Reject reason
+	 * @return Number of rejections
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetRejectCount(EXeusEffectRejectReason Reason) const;
+
+	/**
+	 * @brief Reset counters of all reject reasons
+	 */
+	UFUNCTION(BlueprintCallable)
+	void ResetRejectCounts();
+
+	/**
+	 * @brief Called when incoming effect class was rejected by filter stage
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemEffectRejectedDelegate OnEffectRejected;
+
+	/**
+	 * @brief Add effect by soft class
+	 * If class is not loaded yet it will be streamed asynchronously and added when loaded
+	 * @param InClass Soft effect class
+	 * @return True if added immediately, false if pending or failed
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool AddEffectSoft(TSoftClassPtr<UXeusEffect> InClass);
+
+	/**
+	 * @brief Stream effect classes (and their icons) of bundle and keep them loaded
+	 * @param Bundle Effect bundle
+	 * @see ReleaseEffectBundle
+	 */
+	UFUNCTION(BlueprintCallable)
+	void PreloadEffectBundle(UXeusEffectBundle* Bundle);
+
+	/**
+	 * @brief Release streamed classes of bundle
+	 * @param Bundle Effect bundle
+	 */
+	UFUNCTION(BlueprintCallable)
+	void ReleaseEffectBundle(UXeusEffectBundle* Bundle);
+
+	/**
+	 * @brief Check if all effect classes of bundle are loaded
+	 * @param Bundle Effect bundle
+	 * @return True if loaded
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsEffectBundleLoaded(UXeusEffectBundle* Bundle) const;
+
+	/**
+	 * @brief Add effect by class
+	 * @param InClass Effect class
+	 * @param bSuccess True if created and added
+	 * @param OutEffect Pointer to new instance of effect
+	 */
+	UFUNCTION(BlueprintCallable, DisplayName="Add Effect")
+	void BP_AddEffect(TSubclassOf<UXeusEffect> InClass, bool& bSuccess, UXeusEffect*& OutEffect);
+
+	/**
+	 * @brief Add effect by class. Will try to stack and push effect.
+	 * @param InClass Effect class
+	 * @return Pointer to instance of effect
+	 */
+	UFUNCTION()
+	UXeusEffect* AddEffectImpl(TSubclassOf<UXeusEffect> InClass);
+
+	/**
+	 * @brief Add effect by class on behalf of source. Will try to stack and push effect.
+	 * Source is used by per-source stacking
+	 * @param InClass Effect class
+	 * @param Source Object that applies effect (can be null)
+	 * @return Pointer to instance of effect
+	 */
+	UFUNCTION(BlueprintCallable)
+	UXeusEffect* AddEffectFromSource(TSubclassOf<UXeusEffect> InClass, UObject* Source);
+
+	/**
+	 * @brief Add effect by class on behalf of instigator. Will try to stack and push effect.
+	 * Context of stacked effect stays from its first application, new stack gets only source.
+	 * Instigator of new stack is dropped: effect is not indexed by it and is not stopped by
+	 * StopAllEffectsByInstigator of that instigator. Use stack sources to track who added stacks
+	 * @param InClass Effect class
+	 * @param Context Instigator and source (can be empty)
+	 * @return Pointer to instance of effect
+	 */
+	UFUNCTION(BlueprintCallable)
+	UXeusEffect* AddEffectWithContext(TSubclassOf<UXeusEffect> InClass, const FXeusEffectContext& Context);
+
+	/**
+	 * @brief Template function of AddEffectImpl
+	 * @see AddEffectImpl
+	 * @tparam T Effect class
+	 * @return Pointer to instance of effect
+	 */
+	template <class T>
+	T* AddEffectImplT()
+	{
+		return Cast<T>(AddEffectImpl(T::StaticClass()));
+	}
+
+	/**
+	 * @brief Add effect by class with per-instance settings. Will try to stack and push effect.
+	 * Settings are applied only to new instance, stacked effect keeps values and applied settings
+	 * of its first application (running timers are not rescheduled by new settings)
+	 * @param InClass Effect class
+	 * @param Settings Effect settings (can be cached and reused)
+	 * @param Context Instigator and source
+	 * @return Pointer to instance of effect
+	 */
+	UXeusEffect* AddEffectWithSettingsImpl(TSubclassOf<UXeusEffect> InClass, const FXeusEffectSettings& Settings,
+	                                       const FXeusEffectContext& Context = FXeusEffectContext());
+
+	/**
+	 * @brief Template function of AddEffectWithSettingsImpl
+	 * @tparam T Effect class
+	 * @param Settings Effect settings
+	 * @return Pointer to instance of effect
+	 */
+	template <class T>
+	T* AddEffectWithSettingsImplT(const FXeusEffectSettings& Settings)
+	{
+		return Cast<T>(AddEffectWithSettingsImpl(T::StaticClass(), Settings));
+	}
+
+	/**
+	 * @brief Add effect by class with per-instance settings
+	 * Blueprint version of AddEffectWithSettingsImpl, reflected functions can not have
+	 * default value of struct parameter, so native code uses AddEffectWithSettingsImpl
+	 * @see AddEffectWithSettingsImpl
+	 * @param InClass Effect class
+	 * @param Settings Effect settings
+	 * @param Context Instigator and source (can be empty)
+	 * @return Pointer to instance of effect
+	 */
+	UFUNCTION(BlueprintCallable, meta=(AutoCreateRefTerm="Context"))
+	UXeusEffect* AddEffectWithSpec(TSubclassOf<UXeusEffect> InClass, const FXeusEffectSettings& Settings,
+	                               const FXeusEffectContext& Context);
+
+	/**
+	 * @brief Add effect described by spec asset
+	 * @see AddEffectWithSettingsImpl
+	 * @param Spec Effect class and settings
+	 * @param Context Instigator and source (can be empty)
+	 * @return Pointer to instance of effect
+	 */
+	UFUNCTION(BlueprintCallable, meta=(AutoCreateRefTerm="Context"))
+	UXeusEffect* AddEffectFromSpecAsset(const UXeusEffectSpec* Spec, const FXeusEffectContext& Context);
+
+	/**
+	 * @brief Add effect and get handle instead of pointer
+	 * Use it for poolable effects, pointers to them must not be kept
+	 * @see AddEffectWithContext
+	 * @param InClass Effect class
+	 * @param Context Instigator and source (can be empty)
+	 * @return Handle of new or stacked effect (invalid if not added or effect already ended)
+	 */
+	UFUNCTION(BlueprintCallable, meta=(AutoCreateRefTerm="Context"))
+	FXeusEffectHandle AddEffectWithHandle(TSubclassOf<UXeusEffect> InClass, const FXeusEffectContext& Context);
+
+	/**
+	 * @brief Add effect with per-instance settings and get handle instead of pointer
+	 * @see AddEffectWithSettingsImpl
+	 * @param InClass Effect class
+	 * @param Settings Effect settings
+	 * @param Context Instigator and source (can be empty)
+	 * @return Handle of new or stacked effect (invalid if not added or effect already ended)
+	 */
+	UFUNCTION(BlueprintCallable, meta=(AutoCreateRefTerm="Context"))
+	FXeusEffectHandle AddEffectWithSpecHandle(TSubclassOf<UXeusEffect> InClass, const FXeusEffectSettings& Settings,
+	                                          const FXeusEffectContext& Context);
+
+	/**
+	 * @brief Ends work of effect by class
+	 * @param InClass Effect class
+	 * @return True if stopped, false otherwise
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool StopEffect(TSubclassOf<UXeusEffect> InClass);
+
+
+	/**
+	 * @brief Ends work of effect by instance
+	 * @param InEffectInstance Effect instance
+	 * @return True if stopped, false otherwise
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool StopEffectInstance(UXeusEffect* InEffectInstance);
+
+	/**
+	 * @brief Ends work of effect by handle
+	 * @param Handle Effect handle
+	 * @return True if stopped, false if handle is stale
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool StopEffectByHandle(FXeusEffectHandle Handle);
+
+	/**
+	 * @brief Check if effect of handle is still active
+	 * @param Handle Effect handle
+	 * @return True if valid
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsEffectHandleValid(FXeusEffectHandle Handle) const;
+
+	/**
+	 * @brief Get effect by handle
+	 * @param Handle Effect handle
+	 * @return Pointer to effect (nullptr if handle is stale)
+	 */
+	UFUNCTION(BlueprintPure)
+	UXeusEffect* ResolveEffectHandle(FXeusEffectHandle Handle) const;
+
+	/**
+	 * @brief Template function of StopEffect
+	 * @see StopEffect
+	 * @tparam T Effect class
+	 * @return True if stopped, false otherwise
+	 */
+	template <class T>
+	bool StopEffectT()
+	{
+		return StopEffect(T::StaticClass());
+	}
+
+	/**
+	 * @brief Stop all effect by same class
+	 * If the effects do not stack, there may be several of them. 
+	 * @param InClass Effect class
+	 */
+	UFUNCTION(BlueprintCallable)
+	void StopAllEffectsByClass(TSubclassOf<UXeusEffect> InClass);
+
+	/**
+	 * @brief Stop all existing effects 
+	 */
+	UFUNCTION(BlueprintCallable)
+	void StopAllEffects();
+
+	/**
+	 * @brief Check if we have effect by class
+	 * @param InClass Effect class
+	 * @return True if container has effect, false otherwise
+	 */
+	UFUNCTION(BlueprintPure)
+	bool HasEffect(TSubclassOf<UXeusEffect> InClass) const;
+
+	/**
+	 * @brief Template function of HasEffect
+	 * @see HasEffect
+	 * @tparam T Effect class
+	 * @return True if container has effect, false otherwise
+	 */
+	template <class T>
+	bool HasEffectT() const
+	{
+		return GetEffectByClass(T::StaticClass()) != nullptr;
+	}
+
+	/**
+	 * @brief Try to get effect by class
+	 * @param InClass Effect class
+	 * @return Pointer to instance of effect if found, nullptr otherwise
+	 */
+	UFUNCTION(BlueprintPure)
+	UXeusEffect* GetEffectByClass(TSubclassOf<UXeusEffect> InClass) const;
+
+	/**
+	 * @brief Template function of GetEffectByClass
+	 * @see GetEffectByClass
+	 * @tparam T Effect class
+	 * @return Pointer to instance of effect if found, nullptr otherwise
+	 */
+	template <class T>
+	UXeusEffect* GetEffect() const
+	{
+		UClass* effClass = T::StaticClass();
+		for (int32 i = 0; i < Effects.Num(); ++i)
+			if (IsValid(Effects[i]) && Effects[i]->IsA(effClass))
+				return Effects[i];
+		return nullptr;
+	}
+
+	/**
+	 * @brief Template function of GetEffect
+	 * @tparam T Effect class
+	 * @return Pointer to instance of effect if found, nullptr otherwise
+	 */
+	template <class T>
+	T* GetEffectT() const
+	{
+		return Cast<T>(GetEffectByClass(T::StaticClass()));
+	}
+
+	/**
+	 * @brief Get all effects with same class
+	 * If the effects do not stack, there may be several of them. 
+	 * @param InClass Effects class
+	 * @return Array of pointers to effects with same class
+	 */
+	UFUNCTION(BlueprintCallable)
+	TArray<UXeusEffect*> GetAllEffectsByClass(TSubclassOf<UXeusEffect> InClass) const;
+
+	/**
+	 * @brief Get all effects with same class into existing array
+	 * @param InClass Effects class
+	 * @param OutEffects Array of pointers to effects with same class (reset, its memory is reused)
+	 * @return Count of found effects
+	 */
+	int32 GetAllEffectsByClassTo(TSubclassOf<UXeusEffect> InClass, TArray<UXeusEffect*>& OutEffects) const;
+
+	/**
+	 * @brief Template function of GetAllEffectsByClass
+	 * @tparam T Effects class
+	 * @return Array of pointers to effects with same class
+	 */
+	template <class T>
+	TArray<T*> GetAllEffectsT() const
+	{
+		TArray<T*> res;
+		GetAllEffectsT<T>(res);
+		return res;
+	}
+
+	/**
+	 * @brief Template function of GetAllEffectsByClassTo
+	 * @tparam T Effects class
+	 * @param OutEffects Array of pointers to effects with same class (reset, its memory is reused)
+	 * @return Count of found effects
+	 */
+	template <class T>
+	int32 GetAllEffectsT(TArray<T*>& OutEffects) const
+	{
+		OutEffects.Reset();
+		for (UXeusEffect* effect : Effects)
+			if (T* casted = Cast<T>(effect))
+				if (IsValid(casted))
+					OutEffects.Add(casted);
+		return OutEffects.Num();
+	}
+
+	/**
+	 * @brief Get all effects
+	 * @return Copy of effects container
+	 * @see GetEffectsRef
+	 */
+	UFUNCTION(BlueprintPure)
+	TArray<UXeusEffect*> GetEffects() const;
+
+	/**
+	 * @brief Get all effects without copying
+	 * @return Effects container (valid until effects change)
+	 */
+	const TArray<UXeusEffect*>& GetEffectsRef() const;
+
+	/**
+	 * @brief Get all effects as read-only view
+	 * @return View of effects container (valid until effects change)
+	 */
+	TArrayView<UXeusEffect* const> GetEffectsView() const;
+
+	/**
+	 * @brief Get count of active effects
+	 * @return Count of effects
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetEffectCount() const;
+
+	/**
+	 * @brief Get effect by index (for loops in blueprints without copying container)
+	 * @param Index Index of effect [0, GetEffectCount)
+	 * @return Effect or nullptr if index is invalid
+	 */
+	UFUNCTION(BlueprintPure)
+	UXeusEffect* GetEffectAt(int32 Index) const;
+
+	/**
+	 * @brief Check if any active effect grants tag (or its child tag)
+	 * @param Tag Gameplay tag (Debuff.Stun)
+	 * @return True if granted
+	 */
+	UFUNCTION(BlueprintPure)
+	bool HasMatchingGameplayTag(FGameplayTag Tag) const;
+
+	/**
+	 * @brief Check if active effects grant any of tags
+	 * @param Tags Gameplay tags
+	 * @return True if any is granted
+	 */
+	UFUNCTION(BlueprintPure)
+	bool HasAnyMatchingGameplayTags(const FGameplayTagContainer& Tags) const;
+
+	/**
+	 * @brief Check if active effects grant all of tags
+	 * @param Tags Gameplay tags
+	 * @return True if all are granted
+	 */
+	UFUNCTION(BlueprintPure)
+	bool HasAllMatchingGameplayTags(const FGameplayTagContainer& Tags) const;
+
+	/**
+	 * @brief Get number of active effects that grant tag (or its child tag)
+	 * @param Tag Gameplay tag
+	 * @return Number of effects
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetGameplayTagCount(FGameplayTag Tag) const;
+
+	/**
+	 * @brief Get all active effects that grant tag (or its child tag)
+	 * @param Tag Gameplay tag (Debuff finds Debuff.Stun effects too)
+	 * @return Array of pointers to effects
+	 */
+	UFUNCTION(BlueprintCallable)
+	TArray<UXeusEffect*> GetEffectsWithTag(FGameplayTag Tag) const;
+
+	/**
+	 * @brief Stop all effects that grant tag (or its child tag)
+	 * @param Tag Gameplay tag (Debuff stops all debuffs)
+	 * @return Number of stopped effects
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 StopAllEffectsWithTag(FGameplayTag Tag);
+
+	/**
+	 * @brief Get all active effects applied by instigator
+	 * Effects are found by instigator of their first application, stacks added later are not counted
+	 * @param Instigator Actor from effect context
+	 * @return Array of pointers to effects
+	 */
+	UFUNCTION(BlueprintCallable)
+	TArray<UXeusEffect*> GetEffectsByInstigator(AActor* Instigator) const;
+
+	/**
+	 * @brief Stop all effects applied by instigator (dead caster etc..)
+	 * Works with instigator that is being destroyed.
+	 * Stackable effect is stopped with all its stacks if instigator applied it first,
+	 * effect first applied by another instigator is not touched
+	 * @param Instigator Actor from effect context
+	 * @return Number of stopped effects
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 StopAllEffectsByInstigator(AActor* Instigator);
+
+	/**
+	 * @brief Stop all effects applied by instigator that can be already destroyed
+	 * Same rules as StopAllEffectsByInstigator
+	 * @param InstigatorKey Key of instigator
+	 * @return Number of stopped effects
+	 * @see UXeusEffect::GetInstigatorKey
+	 */
+	int32 StopAllEffectsByInstigatorKey(FObjectKey InstigatorKey);
+
+	/**
+	 * @brief Check if effect class is blocked by tags of active effects
+	 * @param InClass Effect class
+	 * @return True if blocked
+	 * @see UXeusEffect::BlockedTags
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsEffectBlocked(TSubclassOf<UXeusEffect> InClass) const;
+
+	/**
+	 * @brief Stop effect clock for all effects (stun, time stop etc..)
+	 * Timers are not touched, they just do not advance
+	 */
+	UFUNCTION(BlueprintCallable)
+	void PauseAllEffects();
+
+	/**
+	 * @brief Continue effect clock
+	 */
+	UFUNCTION(BlueprintCallable)
+	void ResumeAllEffects();
+
+	/**
+	 * @brief Check if effect clock is stopped
+	 * @return True if effects are paused
+	 */
+	UFUNCTION(BlueprintPure)
+	bool AreEffectsPaused() const;
+
+	/**
+	 * @brief Change speed of effect clock
+	 * @param Value New time scale (1.0 is normal speed)
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetEffectTimeScale(float Value);
+
+	/**
+	 * @brief Get speed of effect clock
+	 * @return Time scale
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetEffectTimeScale() const;
+
+	/**
+	 * @brief Get current time of effect clock
+	 * @return Effect time in seconds
+	 */
+	UFUNCTION(BlueprintPure, DisplayName="Get Effect Time")
+	float BP_GetEffectTime() const;
 
 	/**
-	 * @brief Called when current value of any attribute changed to broadcast event
-	 * @param Attribute Attribute instance
-	 * @param Value New value of attribute
+	 * @brief Get current time of effect clock
+	 * @return Effect time in seconds
 	 */
-	UFUNCTION()
-	void ValueChangedHandle(UXeusAttribute* Attribute, float Value);
+	double GetEffectTime() const;
 
 	/**
-	 * @brief Called when min value of any attribute changed to broadcast event
-	 * @param Attribute Attribute instance
-	 * @param Value New min value of attribute
+	 * @brief Set timer on effect clock
+	 * @param Callback Function to call
+	 * @param Delay Time until first call
+	 * @param bLoop Should timer repeat
+	 * @param Rate Time between repeated calls (Delay is used if not positive)
+	 * @return Timer handle
 	 */
-	UFUNCTION()
-	void MinValueChangedHandle(UXeusAttribute* Attribute, float Value);
+	FXeusEffectTimerHandle SetEffectTimer(FSimpleDelegate Callback, float Delay, bool bLoop, float Rate = -1.0f);
 
 	/**
-	 * @brief Called when max value of any attribute changed to broadcast event
-	 * @param Attribute Attribute instance
-	 * @param Value New max value of attribute
+	 * @brief Remove timer and invalidate handle
+	 * @param Handle Timer handle
 	 */
-	UFUNCTION()
-	void MaxValueChangedHandle(UXeusAttribute* Attribute, float Value);
+	void ClearEffectTimer(FXeusEffectTimerHandle& Handle);
 
 	/**
-	 * @brief Called when value of any attribute clamped to max value
-	 * @param Attribute Attribute instance
+	 * @brief Pause one timer (remaining time is saved)
+	 * @param Handle Timer handle
 	 */
-	UFUNCTION()
-	void MaxHandle(UXeusAttribute* Attribute);
+	void PauseEffectTimer(FXeusEffectTimerHandle Handle);
 
 	/**
-	 * @brief Called when value of any attribute clamped to min value
-	 * @param Attribute Attribute instance
+	 * @brief Unpause one timer
+	 * @param Handle Timer handle
 	 */
-	UFUNCTION()
-	void MinHandle(UXeusAttribute* Attribute);
+	void UnPauseEffectTimer(FXeusEffectTimerHandle Handle);
 
-#pragma endregion
+	/**
+	 * @brief Check if timer exists and is not paused
+	 * @param Handle Timer handle
+	 * @return True if active
+	 */
+	bool IsEffectTimerActive(FXeusEffectTimerHandle Handle) const;
 
-public:
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
-	                           FActorComponentTickFunction* ThisTickFunction) override;
+	/**
+	 * @brief Check if timer exists and is paused
+	 * @param Handle Timer handle
+	 * @return True if paused
+	 */
+	bool IsEffectTimerPaused(FXeusEffectTimerHandle Handle) const;
 
-#pragma endregion
-#pragma region Effects
+	/**
+	 * @brief Get time until next call of timer
+	 * @param Handle Timer handle
+	 * @return Remaining time or -1 if timer does not exist
+	 */
+	float GetEffectTimerRemaining(FXeusEffectTimerHandle Handle) const;
 
-protected:
 	/**
-	 * @brief Service function. Will be called at end play to clear effects memory
-	 * Do not call it directly
+	 * @brief Stable id of component in save files
+	 * Path of owner is used if not set, set it explicitly for spawned actors
+	 * @see UXeusAbilitySaveSubsystem
 	 */
-	UFUNCTION()
-	void RemoveAllEffects();
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="AbilitySystem|Save")
+	FName SaveId;
 
-public:
 	/**
-	 * @brief Initial effects that will be initialized from begin play
+	 * @brief Simulate fixed steps (deterministic mode only)
+	 * @param Steps Count of steps
 	 */
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Effects")
-	TArray<TSubclassOf<UXeusEffect>> InitialEffects;
+	UFUNCTION(BlueprintCallable)
+	void AdvanceFixedStep(int32 Steps = 1);
 
 	/**
-	 * @brief Add effect by class
-	 * @param InClass Effect class
-	 * @param bSuccess True if created and added
-	 * @param OutEffect Pointer to new instance of effect
+	 * @brief Check if component runs in deterministic mode
+	 * @return True if deterministic
 	 */
-	UFUNCTION(BlueprintCallable, DisplayName="Add Effect")
-	void BP_AddEffect(TSubclassOf<UXeusEffect> InClass, bool& bSuccess, UXeusEffect*& OutEffect);
+	UFUNCTION(BlueprintPure)
+	bool IsDeterministic() const;
 
 	/**
-	 * @brief Add effect by class. Will try to stack and push effect.
-	 * @param InClass Effect class
-	 * @return Pointer to instance of effect
+	 * @brief Switch deterministic mode at runtime (spawned components, tools)
+	 * Rollback history is dropped and recorded again from next step
+	 * @param bInDeterministic Effect clock advances only by fixed steps
+	 * @param InHistoryLength Count of steps that can be rewound (0 disables history)
+	 * @param bInAutoStep Run steps from tick
 	 */
-	UFUNCTION()
-	UXeusEffect* AddEffectImpl(TSubclassOf<UXeusEffect> InClass);
+	UFUNCTION(BlueprintCallable)
+	void SetDeterministic(bool bInDeterministic, int32 InHistoryLength = 0, bool bInAutoStep = true);
 
 	/**
-	 * @brief Template function of AddEffectImpl
-	 * @see AddEffectImpl
-	 * @tparam T Effect class
-	 * @return Pointer to instance of effect
+	 * @brief Get count of simulated steps
+	 * @return Step index
 	 */
-	template <class T>
-	T* AddEffectImplT()
-	{
-		return Cast<T>(AddEffectImpl(T::StaticClass()));
-	}
+	UFUNCTION(BlueprintPure)
+	int32 GetStepIndex() const;
 
 	/**
-	 * @deprecated 
-	 * @brief Add effect by class with custom settings
-	 * @param InClass Effect class
-	 * @param Settings Pointer to settings struct
-	 * @return Pointer to instance of effect
+	 * @brief Get state hash after last step
+	 * Compare it between peers to detect desync
+	 * @return Hash of attributes and effects
 	 */
-	UXeusEffect* AddEffectWithSettingsImpl(TSubclassOf<UXeusEffect> InClass, FXeusEffectSettings* Settings);
+	UFUNCTION(BlueprintPure)
+	int32 GetStateHash() const;
 
 	/**
-	 * @deprecated
-	 * @brief Template function of AddEffectWithSettingsImpl
-	 * @tparam T Effect class
-	 * @param Settings Pointer to effect initialization settings struct 
-	 * @return Pointer to instance of effect
+	 * @brief Calculate hash of current state of attributes and effects
+	 * Uses the same data as snapshot, but only hashes it
+	 * @return State hash
 	 */
-	template <class T>
-	T* AddEffectWithSettingsImplT(FXeusEffectSettings* Settings)
-	{
-		return Cast<T>(AddEffectWithSettingsImpl(T::StaticClass(), Settings));
-	}
+	uint32 CalculateStateHash();
 
 	/**
-	 * @brief Ends work of effect by class
-	 * @param InClass Effect class
-	 * @return True if stopped, false otherwise
+	 * @brief Return attributes and effects to state after step
+	 * Effects keep working without Work() being called, timers are rescheduled from restored state
+	 * @param Step Step to return to (GetStepIndex() - GetRollbackDepth() at least)
+	 * @return True if rewound
 	 */
 	UFUNCTION(BlueprintCallable)
-	bool StopEffect(TSubclassOf<UXeusEffect> InClass);
-
+	bool RewindTo(int32 Step);
 
 	/**
-	 * @brief Ends work of effect by instance
-	 * @param InEffectInstance Effect instance
-	 * @return True if stopped, false otherwise
+	 * @brief Simulate steps again after rewind
+	 * OnSimulationStep is called for every step, so inputs of step can be applied in it
+	 * @param Step Step to simulate up to
 	 */
 	UFUNCTION(BlueprintCallable)
-	bool StopEffectInstance(UXeusEffect* InEffectInstance);
+	void ResimulateTo(int32 Step);
 
 	/**
-	 * @brief Template function of StopEffect
-	 * @see StopEffect
-	 * @tparam T Effect class
-	 * @return True if stopped, false otherwise
+	 * @brief Get count of steps that can be rewound now
+	 * @return Count of recorded frames
 	 */
-	template <class T>
-	bool StopEffectT()
-	{
-		return StopEffect(T::StaticClass());
-	}
+	UFUNCTION(BlueprintPure)
+	int32 GetRollbackDepth() const;
 
 	/**
-	 * @brief Stop all effect by same class
-	 * If the effects do not stack, there may be several of them. 
-	 * @param InClass Effect class
+	 * @brief Check if component is resimulating steps after rewind
+	 * @return True while ResimulateTo is running
 	 */
-	UFUNCTION(BlueprintCallable)
-	void StopAllEffectsByClass(TSubclassOf<UXeusEffect> InClass);
+	UFUNCTION(BlueprintPure)
+	bool IsResimulating() const;
 
 	/**
-	 * @brief Stop all existing effects 
+	 * @brief Called after component was rewound to step
 	 */
-	UFUNCTION(BlueprintCallable)
-	void StopAllEffects();
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemStepDelegate OnRewound;
 
 	/**
-	 * @brief Check if we have effect by class
-	 * @param InClass Effect class
-	 * @return True if container has effect, false otherwise
+	 * @brief Called after every simulated step with its state hash (0 if hashing is disabled)
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemStepDelegate OnSimulationStep;
+
+	/**
+	 * @brief Get stable id of component in save files
+	 * @return SaveId or path of owner
 	 */
 	UFUNCTION(BlueprintPure)
-	bool HasEffect(TSubclassOf<UXeusEffect> InClass) const;
+	FName GetSaveId() const;
 
 	/**
-	 * @brief Template function of HasEffect
-	 * @see HasEffect
-	 * @tparam T Effect class
-	 * @return True if container has effect, false otherwise
+	 * @brief Get revision of state, snapshot captured with the same revision is still up to date
+	 * Effect clock changes state only while there are effects or timers
+	 * @return State revision
 	 */
-	template <class T>
-	bool HasEffectT() const
-	{
-		return GetEffectByClass(T::StaticClass()) != nullptr;
-	}
+	uint32 GetStateRevision() const;
 
 	/**
-	 * @brief Try to get effect by class
-	 * @param InClass Effect class
-	 * @return Pointer to instance of effect if found, nullptr otherwise
+	 * @brief Mark state as changed (new state revision)
+	 * Called by effects when their state changes outside of component events
 	 */
-	UFUNCTION(BlueprintPure)
-	UXeusEffect* GetEffectByClass(TSubclassOf<UXeusEffect> InClass) const;
+	void MarkStateChanged();
 
 	/**
-	 * @brief Template function of GetEffectByClass
-	 * @see GetEffectByClass
-	 * @tparam T Effect class
-	 * @return Pointer to instance of effect if found, nullptr otherwise
+	 * @brief Save attributes, their multipliers and active effects to snapshot
+	 * @return Snapshot of component state
 	 */
-	template <class T>
-	UXeusEffect* GetEffect() const
-	{
-		UClass* effClass = T::StaticClass();
-		for (int32 i = 0; i < Effects.Num(); ++i)
-			if (IsValid(Effects[i]) && Effects[i]->IsA(effClass))
-				return Effects[i];
-		return nullptr;
-	}
+	UFUNCTION(BlueprintCallable)
+	FXeusAbilitySystemSnapshot CaptureSnapshot();
 
 	/**
-	 * @brief Template function of GetEffect
-	 * @tparam T Effect class
-	 * @return Pointer to instance of effect if found, nullptr otherwise
+	 * @brief Save state to existing snapshot (its buffer is reused)
+	 * @param OutSnapshot Snapshot to write
 	 */
-	template <class T>
-	T* GetEffectT() const
-	{
-		return Cast<T>(GetEffectByClass(T::StaticClass()));
-	}
+	void CaptureSnapshotTo(FXeusAbilitySystemSnapshot& OutSnapshot);
 
 	/**
-	 * @brief Get all effects with same class
-	 * If the effects do not stack, there may be several of them. 
-	 * @param InClass Effects class
-	 * @return Array of pointers to effects with same class
+	 * @brief Replace active effects and values of attributes with state from snapshot
+	 * Missing attributes are added, attributes that are not in snapshot are not touched
+	 * Restored effects continue work without Work() being called
+	 * If some classes of snapshot are not loaded, they are streamed and state is restored later
+	 * Snapshots of older versions are migrated while reading
+	 * All records are checked before current state is touched, broken snapshot changes nothing
+	 * @param Snapshot Snapshot of component state
+	 * @param bFireStartEvents Broadcast OnEffectStartedWork and OnValueChanged for restored state
+	 * @param bFireEndEvents Broadcast OnEffectEndWork and EffectRemoving for replaced effects
+	 * @return True if snapshot was valid (restored or waits for its classes)
 	 */
 	UFUNCTION(BlueprintCallable)
-	TArray<UXeusEffect*> GetAllEffectsByClass(TSubclassOf<UXeusEffect> InClass) const;
+	bool RestoreSnapshot(const FXeusAbilitySystemSnapshot& Snapshot, bool bFireStartEvents = false,
+	                     bool bFireEndEvents = false);
 
 	/**
-	 * @brief Template function of GetAllEffectsByClass
-	 * @tparam T Effects class
-	 * @return Array of pointers to effects with same class
+	 * @brief Called when effect clock was stopped
 	 */
-	template <class T>
-	TArray<T*> GetAllEffectsT() const
-	{
-		TArray<UXeusEffect*> effects = GetAllEffectsByClass(T::StaticClass());
-		TArray<T*> res;
-		for (int32 i = 0; i < effects.Num(); ++i)
-		{
-			res.Add(Cast<T>(effects[i]));
-		}
-		return res;
-	}
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemActionDelegate OnEffectsPaused;
 
 	/**
-	 * @brief Get all effects
-	 * @return Effects container
+	 * @brief Called when effect clock was continued
 	 */
-	UFUNCTION(BlueprintPure)
-	TArray<UXeusEffect*> GetEffects() const;
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemActionDelegate OnEffectsResumed;
 
 	/**
 	 * @brief Called when some effect started working
@@ -377,6 +1734,28 @@ public:
 	UPROPERTY(BlueprintAssignable)
 	FAbilitySystemXeusEffectActionDelegate OnEffectEndWork;
 
+	/**
+	 * @brief Called when effect is removed from component for any reason (end of work, stop, rewind)
+	 * Effect can be already returned to pool after this call
+	 * @see UnlinkEffect
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemXeusEffectActionDelegate OnEffectUnlinked;
+
+	/**
+	 * @brief Called when tag was granted for the first time or lost by the last effect
+	 * Count is 0 when tag is lost
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemTagCountDelegate OnGameplayTagCountChanged;
+
+	/**
+	 * @brief Called when effects or attributes were replaced without events for each of them
+	 * @see RestoreSnapshot, RewindTo, RemoveAllEffects
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemActionDelegate OnStateReset;
+
 
 #pragma endregion
 #pragma region Attributes
@@ -387,6 +1766,20 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Attributes")
 	TArray<TSubclassOf<UXeusAttribute>> InitialAttributes;
 
+	/**
+	 * @brief Initial attributes that will be streamed asynchronously and added when loaded
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Attributes")
+	TArray<TSoftClassPtr<UXeusAttribute>> SoftInitialAttributes;
+
+	/**
+	 * @brief Shared attribute set of this archetype
+	 * All attributes of set are created at begin play and initialized from its definitions
+	 * Attributes of the same class added later are initialized from it too
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|Attributes")
+	UXeusAttributeSetDefinition* AttributeSet;
+
 	/**
 	 * @brief Check if we have attribute by class
 	 * @param InClass Attribute class
@@ -442,6 +1835,33 @@ public:
 	UFUNCTION(BlueprintPure)
 	TArray<UXeusAttribute*> GetAttributes() const;
 
+	/**
+	 * @brief Get all attributes without copying
+	 * @return Attributes container (valid until attributes change)
+	 */
+	const TArray<UXeusAttribute*>& GetAttributesRef() const;
+
+	/**
+	 * @brief Get all attributes as read-only view
+	 * @return View of attributes container (valid until attributes change)
+	 */
+	TArrayView<UXeusAttribute* const> GetAttributesView() const;
+
+	/**
+	 * @brief Get count of attributes
+	 * @return Count of attributes
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetAttributeCount() const;
+
+	/**
+	 * @brief Get attribute by index (for loops in blueprints without copying container)
+	 * @param Index Index of attribute [0, GetAttributeCount)
+	 * @return Attribute or nullptr if index is invalid
+	 */
+	UFUNCTION(BlueprintPure)
+	UXeusAttribute* GetAttributeAt(int32 Index) const;
+
 	/**
 	 * @brief Add attribute by class (should be unique)
 	 * @param InClass Attribute class (unique)
@@ -502,6 +1922,96 @@ public:
 	UPROPERTY(BlueprintAssignable)
 	FAbilitySystemAttributeDelegate OnMaxValue;
 
+	/**
+	 * @brief Called when attribute was added
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemAttributeDelegate OnAttributeAdded;
+
+	/**
+	 * @brief Called before attribute is removed
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FAbilitySystemAttributeDelegate OnAttributeRemoved;
+
+
+#pragma endregion
+#pragma region UI
+
+protected:
+	/**
+	 * @brief Rows for widgets (created on first request)
+	 */
+	UPROPERTY(Transient)
+	UXeusAbilitySystemViewModel* ViewModel;
+
+	/**
+	 * @brief Start async loading of icons when displayable effects are added
+	 * so widgets do not load them synchronously
+	 * Icons are cached by UXeusEffectIconSubsystem with one memory budget for the world
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="AbilitySystem|UI")
+	bool bPrefetchIcons;
+
+	/**
+	 * @brief Icon cache of world (found on first icon request)
+	 */
+	UPROPERTY(Transient)
+	UXeusEffectIconSubsystem* IconSubsystem;
+
+	/**
+	 * @brief Icons requested for live effects, the same path is released when effect is removed
+	 */
+	TMap<UXeusEffect*, FSoftObjectPath> EffectIcons;
+
+	/**
+	 * @brief Get icon cache of world
+	 * @return Icon subsystem or nullptr outside of world
+	 */
+	UXeusEffectIconSubsystem* GetIconSubsystem();
+
+	/**
+	 * @brief Request icon of displayable effect and add reference to it
+	 * @param InEffect Added effect
+	 */
+	void AcquireEffectIcon(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Remove reference to icon of effect
+	 * @param InEffect Removed effect
+	 */
+	void ReleaseEffectIcon(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Remove references to icons of all effects
+	 */
+	void ReleaseAllIcons();
+
+public:
+	/**
+	 * @brief Get view model of component that widgets can bind to
+	 * Rows are updated from component events, so widgets do not rebuild them every frame
+	 * @return View model bound to this component
+	 */
+	UFUNCTION(BlueprintCallable)
+	UXeusAbilitySystemViewModel* GetViewModel();
+
+	/**
+	 * @brief Check if icon of effect class is prefetched and loaded
+	 * @param InClass Effect class
+	 * @return True if icon is in memory
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsEffectIconLoaded(TSubclassOf<UXeusEffect> InClass) const;
+
+	/**
+	 * @brief Get memory of prefetched icons of world
+	 * @return Memory in MB
+	 * @see UXeusEffectIconSubsystem
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetIconCacheSizeMB() const;
+
 
 #pragma endregion
 };
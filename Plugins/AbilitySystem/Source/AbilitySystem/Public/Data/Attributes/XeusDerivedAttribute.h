@@ -0,0 +1,115 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/XeusAttribute.h"
+
+#include "XeusDerivedAttribute.generated.h"
+
+// Which part of derived attribute is calculated from inputs
+UENUM(BlueprintType)
+enum class EXeusDerivedAttributeTarget : uint8
+{
+	Value,
+	MaxValue,
+	MinValue
+};
+
+// Which part of input attribute is used in calculation
+UENUM(BlueprintType)
+enum class EXeusDerivedAttributeInput : uint8
+{
+	Value,
+	MaxValue,
+	MinValue,
+	Percent
+};
+
+// One input of derived attribute
+// Default calculation is: BaseValue + Sum(Coefficient * Input)
+USTRUCT(BlueprintType)
+struct FXeusDerivedAttributeTerm
+{
+	GENERATED_BODY()
+public:
+	FXeusDerivedAttributeTerm();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<UXeusAttribute> Source;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EXeusDerivedAttributeInput Input;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Coefficient;
+};
+
+/**
+ * Attribute which value (or max/min value) is a function of other attributes on the same component
+ * Ability system component recalculates it once per frame when any of inputs changed
+ * You can override ComputeDerivedValue for custom formula
+ */
+UCLASS(Abstract, BlueprintType, Blueprintable, ClassGroup=(XeusAbilitySystem))
+class ABILITYSYSTEM_API UXeusDerivedAttribute : public UXeusAttribute
+{
+	GENERATED_BODY()
+public:
+	UXeusDerivedAttribute(const FObjectInitializer& ObjectInitializer);
+
+protected:
+	/**
+	 * @brief Part of attribute that is calculated from inputs
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Derived")
+	EXeusDerivedAttributeTarget Target;
+
+	/**
+	 * @brief Constant part of default formula
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Derived")
+	float BaseValue;
+
+	/**
+	 * @brief Inputs of derived attribute
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Derived")
+	TArray<FXeusDerivedAttributeTerm> Terms;
+
+	/**
+	 * @brief Calculate derived value
+	 * @param Inputs Input attributes in the same order as Terms (can contain nullptr if missing)
+	 * @return New value of target
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	float ComputeDerivedValue(const TArray<UXeusAttribute*>& Inputs) const;
+
+public:
+	/**
+	 * @brief Get inputs of derived attribute
+	 * @return Terms array
+	 */
+	const TArray<FXeusDerivedAttributeTerm>& GetTerms() const;
+
+	/**
+	 * @brief Get part of attribute that is calculated from inputs
+	 * @return Derived target
+	 */
+	UFUNCTION(BlueprintPure)
+	EXeusDerivedAttributeTarget GetTarget() const;
+
+	/**
+	 * @brief Calculate derived value and apply it to target
+	 * Does nothing if value was not changed
+	 * @param Inputs Input attributes in the same order as Terms
+	 */
+	void Recompute(const TArray<UXeusAttribute*>& Inputs);
+
+	/**
+	 * @brief Get part of input attribute
+	 * @param Attribute Input attribute
+	 * @param Input Part of attribute
+	 * @return Value of input
+	 */
+	static float GetInputValue(const UXeusAttribute* Attribute, EXeusDerivedAttributeInput Input);
+};
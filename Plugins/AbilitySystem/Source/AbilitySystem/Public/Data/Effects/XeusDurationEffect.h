@@ -0,0 +1,169 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/XeusEffect.h"
+
+#include "XeusDurationEffect.generated.h"
+
+class UXeusDurationEffect;
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FXeusDurationEffectValueDelegate,
+                                             UXeusDurationEffect*, Effect, float, Value);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FXeusDurationEffectBoolDelegate,
+                                             UXeusDurationEffect*, Effect, bool, Value);
+
+/**
+ * An effect that works for fixed duration and asks for removal when it expires.
+ * Progress is calculated on demand from effect clock, only expiration is scheduled
+ */
+UCLASS(Abstract, BlueprintType, Blueprintable, ClassGroup=(XeusAbilitySystem))
+class ABILITYSYSTEM_API UXeusDurationEffect : public UXeusEffect
+{
+	GENERATED_BODY()
+
+public:
+	UXeusDurationEffect(const FObjectInitializer& ObjectInitializer);
+
+private:
+	FXeusEffectTimerHandle ExpireTimerHandle;
+
+protected:
+	/**
+	 * @brief Duration of effect in seconds
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta=(ClampMin=0.001))
+	float Duration;
+
+	/**
+	 * @brief Effect time when effect started (or was refreshed)
+	 */
+	double StartTime;
+
+	/**
+	 * @brief Total time effect spent on pause since start
+	 */
+	double PausedTime;
+
+	/**
+	 * @brief Effect time when current pause started
+	 */
+	double PauseStartTime;
+
+	/**
+	 * @brief Is effect paused
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	bool bPaused;
+
+private:
+	/**
+	 * @brief Schedule expiration for remaining time (it will refresh timer)
+	 */
+	void ScheduleExpire();
+
+	/**
+	 * @brief Clear expiration timer
+	 */
+	void ClearExpire();
+
+protected:
+	/**
+	 * @brief Called once when duration is over
+	 * By default ends work of effect
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	void Expired();
+
+	/**
+	 * @brief Starts duration
+	 */
+	virtual void Work_Implementation() override;
+
+	/**
+	 * @brief Clears expiration
+	 */
+	virtual void EndWork_Implementation() override;
+
+	/**
+	 * @brief Restart duration from the beginning
+	 */
+	virtual void RefreshDuration() override;
+
+	/**
+	 * @brief Add default duration to current one
+	 */
+	virtual void ExtendDuration() override;
+
+	/**
+	 * @brief Schedules expiration for restored remaining time
+	 */
+	virtual void RestoreWork() override;
+
+public:
+	virtual void SerializeState(FArchive& Ar) override;
+	virtual void ResetState_Implementation() override;
+	virtual void Setup(const FXeusEffectSettings& Settings) override;
+
+	/**
+	 * @brief Change duration (remaining time is recalculated)
+	 * @param Value New duration
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetDuration(float Value);
+
+	/**
+	 * @brief Pause or unpause effect
+	 * @param Value True to pause
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetPaused(bool Value);
+
+	/**
+	 * @brief Get duration
+	 * @return Duration in seconds
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetDuration() const;
+
+	/**
+	 * @brief Get time effect has been working (pauses excluded)
+	 * @return Elapsed time in seconds
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetElapsedTime() const;
+
+	/**
+	 * @brief Get time left until expiration
+	 * @return Remaining time in seconds
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetRemainingTime() const;
+
+	/**
+	 * @brief Get ratio of elapsed time and duration
+	 * @return Percent of duration completed (0.0 - 1.0)
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetPercent() const;
+
+	/**
+	 * @brief Check if effect is paused
+	 * @return True if paused
+	 */
+	UFUNCTION(BlueprintPure)
+	bool GetIsPaused() const;
+
+	/**
+	 * @brief Called when duration changed (set, refreshed or extended)
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusDurationEffectValueDelegate OnDurationChanged;
+
+	/**
+	 * @brief Called when effect paused or unpaused
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusDurationEffectBoolDelegate OnPausedChanged;
+};
@@ -9,6 +9,8 @@
 
 /**
  * A periodic effect that does work every N seconds
+ * In catch-up mode count of ticks is calculated from elapsed time,
+ * so total output does not depend on server tick rate
  * You need to delete it yourself
  */
 UCLASS()
@@ -18,8 +20,10 @@ class ABILITYSYSTEM_API UXeusPereodicEffect : public UXeusEffect
 public:
 	UXeusPereodicEffect(const FObjectInitializer& ObjectInitializer);
 protected:
-	UPROPERTY()
-	FTimerHandle TimerHandle;
+	/**
+	 * @brief Timer on effect clock of ability system component
+	 */
+	FXeusEffectTimerHandle TimerHandle;
 
 	/**
 	 * @brief Tick rate
@@ -32,6 +36,62 @@ protected:
 	 */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	float Value;
+
+	/**
+	 * @brief Calculate count of ticks from time elapsed since start
+	 * Periods missed because of hitches or low tick rate are fired on next timer callback
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	bool bCatchUp;
+
+	/**
+	 * @brief Fire all missed periods as one PeriodTicks call instead of several PeriodTick calls
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta=(EditCondition="bCatchUp"))
+	bool bCollapseTicks;
+
+	/**
+	 * @brief Effect time when effect started
+	 */
+	double StartTime;
+
+	/**
+	 * @brief Count of periods fired since start
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	int32 TicksFired;
+
+	/**
+	 * @brief Total output emitted since start in fixed point units
+	 * @see FixedPointScale
+	 */
+	int64 EmittedOutput;
+
+	/**
+	 * @brief Count of fixed point units in 1.0 of Value
+	 */
+	static constexpr int64 FixedPointScale = 10000;
+
+	/**
+	 * @brief Timer callback. Fires one tick or all due ticks in catch-up mode
+	 */
+	void TimerTick();
+
+	/**
+	 * @brief Fire all periods that are due by elapsed time
+	 */
+	void FireDueTicks();
+
+	/**
+	 * @brief Restarts period timer with restored time of next tick
+	 */
+	virtual void RestoreWork() override;
+
+	/**
+	 * @brief Time until next tick (used while restoring)
+	 */
+	float NextTickRemaining;
+
 public:
 	/**
 	 * @brief Work of effect.
@@ -39,7 +99,34 @@ public:
 	 */
 	UFUNCTION(BlueprintNativeEvent)
 	void PeriodTick();
+
+	/**
+	 * @brief Work of effect for several periods at once (catch-up mode with collapsed ticks)
+	 * By default calls PeriodTick Count times
+	 * @param Count Count of periods
+	 * @param Amount Exact output of these periods (Value * Count without accumulated rounding error)
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	void PeriodTicks(int32 Count, float Amount);
+
+	/**
+	 * @brief Get count of periods fired since start
+	 * @return Ticks count
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetTicksFired() const;
+
+	/**
+	 * @brief Get total output emitted since start (TicksFired * Value)
+	 * @return Total output
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetTotalOutput() const;
 	
+	virtual void SerializeState(FArchive& Ar) override;
+	virtual void ResetState_Implementation() override;
+	virtual void Setup(const FXeusEffectSettings& Settings) override;
+
 	virtual void Work_Implementation() override;
 	virtual void EndWork_Implementation() override;
 };
@@ -27,7 +27,12 @@ public:
 	UXeusProgressEffect(const FObjectInitializer& ObjectInitializer);
 
 private:
-	FTimerHandle ProgressTimerHandle;
+	FXeusEffectTimerHandle ProgressTimerHandle;
+
+	/**
+	 * @brief Time until next tick (used while restoring)
+	 */
+	float NextTickRemaining;
 
 protected:
 	/**
@@ -89,7 +94,38 @@ protected:
 	 */
 	virtual void Work_Implementation() override;
 
+	/**
+	 * @brief Clears tick timer
+	 */
+	virtual void EndWork_Implementation() override;
+
+	/**
+	 * @brief Reset progress to zero
+	 */
+	virtual void RefreshDuration() override;
+
+	/**
+	 * @brief Add default progress target to current one
+	 */
+	virtual void ExtendDuration() override;
+
+	/**
+	 * @brief Restarts tick timer with restored time of next tick
+	 */
+	virtual void RestoreWork() override;
+
 public:
+	virtual void SerializeState(FArchive& Ar) override;
+	virtual void ResetState_Implementation() override;
+
+	/**
+	 * @brief Map settings to progress fields
+	 * Magnitude is ProgressAmount, Period is ProgressRate,
+	 * Duration is NeedProgress (clamped to 1 as ClampMin of NeedProgress)
+	 * @param Settings Effect settings
+	 */
+	virtual void Setup(const FXeusEffectSettings& Settings) override;
+
 	/**
 	 * @brief Change progress directly
 	 * @param Value New progress value
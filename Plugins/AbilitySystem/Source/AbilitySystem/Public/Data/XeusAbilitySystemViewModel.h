@@ -0,0 +1,239 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "AbilitySystemTypes.h"
+
+#include "XeusAbilitySystemViewModel.generated.h"
+
+class UXeusAbilitySystemComponent;
+class UXeusAbilitySystemViewModel;
+class UXeusAttribute;
+class UXeusEffect;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FXeusViewModelRowDelegate,
+                                             UXeusAbilitySystemViewModel*, ViewModel, int32, Row);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FXeusViewModelActionDelegate, UXeusAbilitySystemViewModel*, ViewModel);
+
+/**
+ * Persistent rows of attributes and effects of one ability system component for widgets
+ * Rows are updated from component events, widgets read only rows that changed
+ * @see UXeusAbilitySystemComponent::GetViewModel
+ */
+UCLASS(BlueprintType, ClassGroup=(XeusAbilitySystem))
+class ABILITYSYSTEM_API UXeusAbilitySystemViewModel : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UXeusAbilitySystemViewModel();
+
+protected:
+	/**
+	 * @brief Component rows are taken from
+	 */
+	UPROPERTY(BlueprintReadOnly, Transient)
+	UXeusAbilitySystemComponent* AbilitySystem;
+
+	/**
+	 * @brief Rows of attributes (in order of adding)
+	 */
+	UPROPERTY(BlueprintReadOnly, Transient)
+	TArray<FAttributeData> AttributeRows;
+
+	/**
+	 * @brief Rows of effects (in order of adding)
+	 */
+	UPROPERTY(BlueprintReadOnly, Transient)
+	TArray<FEffectData> EffectRows;
+
+	/**
+	 * @brief Row index of attribute
+	 */
+	TMap<UXeusAttribute*, int32> AttributeIndices;
+
+	/**
+	 * @brief Row index of effect
+	 */
+	TMap<UXeusEffect*, int32> EffectIndices;
+
+	/**
+	 * @brief Attribute rows changed since last ConsumeDirtyAttributeRows
+	 */
+	TArray<int32> DirtyAttributeRows;
+
+	/**
+	 * @brief Is row in DirtyAttributeRows (same indices as AttributeRows)
+	 */
+	TBitArray<> DirtyAttributeFlags;
+
+	/**
+	 * @brief Were effect rows added or removed since last ConsumeEffectRowsChanged
+	 */
+	bool bEffectRowsChanged;
+
+	/**
+	 * @brief Make row of effect with cached display name of its class
+	 * @param Effect Effect instance
+	 * @return Row of effect
+	 */
+	static FEffectData MakeEffectRow(UXeusEffect* Effect);
+
+	/**
+	 * @brief Add row of attribute if it does not exist
+	 * @param Attribute Attribute instance
+	 * @return Row index
+	 */
+	int32 AddAttributeRow(UXeusAttribute* Attribute);
+
+	/**
+	 * @brief Remove row of attribute and fix indices of next rows
+	 * @param Attribute Attribute instance
+	 */
+	void RemoveAttributeRow(UXeusAttribute* Attribute);
+
+	/**
+	 * @brief Bind or unbind multiplier events of attribute
+	 * @param Attribute Attribute instance
+	 * @param bBind True to bind
+	 */
+	void BindAttribute(UXeusAttribute* Attribute, bool bBind);
+
+	/**
+	 * @brief Copy values of attribute to its row and mark it dirty
+	 * @param Attribute Attribute instance
+	 * @param bForce Mark row dirty even if values are the same
+	 */
+	void UpdateAttributeRow(UXeusAttribute* Attribute, bool bForce = false);
+
+	/**
+	 * @brief Add or remove row and fix indices of next rows
+	 */
+	void AddEffectRow(UXeusEffect* Effect);
+	void RemoveEffectRow(UXeusEffect* Effect);
+
+	/**
+	 * @brief Mark attribute row as changed
+	 * @param Row Row index
+	 */
+	void MarkAttributeRowDirty(int32 Row);
+
+	/**
+	 * @brief Rebuild all rows from component
+	 */
+	void Rebuild();
+
+	/**
+	 * @brief Rebuild effect rows from component
+	 */
+	void RebuildEffectRows();
+
+	UFUNCTION()
+	void Component_ValueChanged(UXeusAbilitySystemComponent* Component, UXeusAttribute* Attribute, float Value);
+
+	UFUNCTION()
+	void Component_AttributeAdded(UXeusAbilitySystemComponent* Component, UXeusAttribute* Attribute);
+
+	UFUNCTION()
+	void Component_AttributeRemoved(UXeusAbilitySystemComponent* Component, UXeusAttribute* Attribute);
+
+	UFUNCTION()
+	void Component_EffectStarted(UXeusAbilitySystemComponent* Component, UXeusEffect* Effect);
+
+	UFUNCTION()
+	void Component_EffectEnded(UXeusAbilitySystemComponent* Component, UXeusEffect* Effect);
+
+	UFUNCTION()
+	void Component_StateReset(UXeusAbilitySystemComponent* Component);
+
+	UFUNCTION()
+	void Attribute_MultChanged(UXeusAttribute* Attribute, FName UniqueId);
+
+	UFUNCTION()
+	void Attribute_MultRemoved(UXeusAttribute* Attribute);
+
+public:
+	/**
+	 * @brief Bind to component events and build rows
+	 * @param InAbilitySystem Ability system component (null to unbind)
+	 */
+	UFUNCTION(BlueprintCallable)
+	void Bind(UXeusAbilitySystemComponent* InAbilitySystem);
+
+	/**
+	 * @brief Get all attribute rows
+	 * @return Rows of attributes
+	 */
+	const TArray<FAttributeData>& GetAttributeRows() const;
+
+	/**
+	 * @brief Get all effect rows
+	 * @return Rows of effects
+	 */
+	const TArray<FEffectData>& GetEffectRows() const;
+
+	/**
+	 * @brief Get count of attribute rows
+	 * @return Count of rows
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetAttributeRowCount() const;
+
+	/**
+	 * @brief Get attribute row by index
+	 * @param Row Row index
+	 * @return Copy of row (empty if index is invalid)
+	 */
+	UFUNCTION(BlueprintPure)
+	FAttributeData GetAttributeRow(int32 Row) const;
+
+	/**
+	 * @brief Get count of effect rows
+	 * @return Count of rows
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetEffectRowCount() const;
+
+	/**
+	 * @brief Get effect row by index
+	 * @param Row Row index
+	 * @return Copy of row (empty if index is invalid)
+	 */
+	UFUNCTION(BlueprintPure)
+	FEffectData GetEffectRow(int32 Row) const;
+
+	/**
+	 * @brief Get indices of attribute rows changed since last call and clear them
+	 * @param OutRows Indices of changed rows (array is reused)
+	 * @return True if any row changed
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool ConsumeDirtyAttributeRows(TArray<int32>& OutRows);
+
+	/**
+	 * @brief Check if effect rows were added or removed since last call and clear flag
+	 * @return True if effect rows changed
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool ConsumeEffectRowsChanged();
+
+	/**
+	 * @brief Called when values of attribute row changed
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusViewModelRowDelegate OnAttributeRowChanged;
+
+	/**
+	 * @brief Called when attribute rows were added or removed
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusViewModelActionDelegate OnAttributeRowsChanged;
+
+	/**
+	 * @brief Called when effect rows were added or removed
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusViewModelActionDelegate OnEffectRowsChanged;
+};
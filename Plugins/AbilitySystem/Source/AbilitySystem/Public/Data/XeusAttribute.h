@@ -4,9 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "UObject/Object.h"
+#include "AbilitySystemTypes.h"
 #include "XeusAttribute.generated.h"
 
 class UXeusAttribute;
+class UXeusAttributeSetDefinition;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FXeusAttributeValueDelegate, UXeusAttribute*, Attribute, float, Value);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FXeusAttributeActionDelegate, UXeusAttribute*, Attribute);
@@ -60,19 +62,83 @@ protected:
 
 	/**
 	 * @brief Default value for effect
+	 * Not used if attribute was initialized from definition, it is read from attribute set instead
+	 * @see GetDefaultValue
 	 */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	float DefaultValue;
 
+	/**
+	 * @brief Localized name for HUD display
+	 * Name of class is used if empty
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	FText DisplayName;
+
+	/**
+	 * @brief Attribute set asset this attribute was initialized from (can be null)
+	 * Definition is looked up in the set by attribute class when needed, so the attribute
+	 * never points into memory of asset array or data table rows
+	 * @see InitFromDefinition
+	 */
+	UPROPERTY(Transient)
+	UXeusAttributeSetDefinition* DefinitionSet;
+
 	/**
 	 * @deprecated 
 	 * @brief Container of multipliers
+	 * Order of multipliers is not preserved
 	 */
 	UPROPERTY(BlueprintReadOnly)
 	TArray<FAttributeMultiplier> Mults;
+
+	/**
+	 * @brief Cached products of multipliers by type
+	 * @see EAttributeMultiplierType
+	 */
+	mutable FAttributeMultiplierBucket MultBuckets[static_cast<int32>(EAttributeMultiplierType::MAX)];
+
+	/**
+	 * @brief Index of multiplier in Mults by its unique id
+	 */
+	TMap<FName, int32> MultIndices;
 protected:
+	/**
+	 * @brief Get cached product of multipliers by type
+	 * @param InType Multiplier type
+	 * @return Bucket of multiplier type
+	 */
+	FAttributeMultiplierBucket& GetMultBucket(EAttributeMultiplierType InType) const;
+
+	/**
+	 * @brief Swap-remove multiplier and fix index of moved one
+	 * @param Index Index of multiplier in Mults
+	 */
+	void RemoveMultAt(int32 Index);
 
 public:
+	/**
+	 * @brief Initialize state of attribute from definition of its class in attribute set
+	 * Should be called before attribute is used, does not broadcast events
+	 * @param InSet Attribute set asset
+	 * @return True if set has definition of this attribute class
+	 */
+	bool InitFromDefinition(UXeusAttributeSetDefinition* InSet);
+
+	/**
+	 * @brief Save or load values and multipliers of attribute
+	 * Loading does not broadcast events
+	 * @param Ar Snapshot archive
+	 */
+	virtual void SerializeState(FArchive& Ar);
+
+	/**
+	 * @brief Get default value from definition or class defaults
+	 * @return Default value
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetDefaultValue() const;
+
 	/**
 	 * @deprecated 
 	 * @brief Get all multipliers by type
@@ -117,6 +183,13 @@ public:
 	UFUNCTION(BlueprintCallable)
 	bool RemoveMult(FName InId);
 
+	/**
+	 * @brief Add new multiplier or change value and type of existing one
+	 * @param InMult Mult data
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetMult(FAttributeMultiplier InMult);
+
 	/**
 	 * @deprecated 
 	 * @brief Get multiplier by custom id
@@ -216,6 +289,26 @@ public:
 	UFUNCTION(BlueprintPure)
 	virtual FString GetDebugName();
 
+	/**
+	 * @brief Get display name and id of attribute class (resolved once per class)
+	 * @return Cached name of class
+	 */
+	const FXeusClassDisplayName& GetClassDisplayName() const;
+
+	/**
+	 * @brief Get localized name for HUD display
+	 * @return DisplayName or name of class
+	 */
+	UFUNCTION(BlueprintPure)
+	FText GetDisplayName() const;
+
+	/**
+	 * @brief Get short id of attribute class (class name without blueprint suffix)
+	 * @return Id of class
+	 */
+	UFUNCTION(BlueprintPure)
+	FName GetDisplayId() const;
+
 	/**
 	 * @brief Called when current value changed
 	 */
@@ -259,6 +352,12 @@ public:
 	 */
 	UPROPERTY(BlueprintAssignable)
 	FXeusAttributeActionDelegate OnMultRemoved;
+
+	/**
+	 * @brief Called when value of existing multiplier (unique id is passed) was changed
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusAttributeMultDelegate OnMultChanged;
 	
 };
 
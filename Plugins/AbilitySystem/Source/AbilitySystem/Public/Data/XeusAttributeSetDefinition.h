@@ -0,0 +1,96 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Engine/DataTable.h"
+
+#include "XeusAttributeSetDefinition.generated.h"
+
+class UXeusAttribute;
+
+// Immutable defaults of one attribute
+// Can be used as row of data table
+USTRUCT(BlueprintType)
+struct FXeusAttributeDefinition : public FTableRowBase
+{
+	GENERATED_BODY()
+public:
+	FXeusAttributeDefinition();
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TSubclassOf<UXeusAttribute> AttributeClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float MinValue;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float MaxValue;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float DefaultValue;
+};
+
+/**
+ * Shared definition of attribute set for one archetype of units
+ * Ability system component creates all attributes of the set at begin play
+ * and initializes them from these defaults
+ */
+UCLASS(BlueprintType, ClassGroup=(XeusAbilitySystem))
+class ABILITYSYSTEM_API UXeusAttributeSetDefinition : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+public:
+	/**
+	 * @brief Attribute definitions of set
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TArray<FXeusAttributeDefinition> Attributes;
+
+	/**
+	 * @brief Optional data table with FXeusAttributeDefinition rows
+	 * Rows are used in addition to Attributes array
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta=(RequiredAssetDataTags="RowStructure=XeusAttributeDefinition"))
+	UDataTable* AttributesTable;
+
+private:
+	/**
+	 * @brief All definitions (array and table rows)
+	 */
+	mutable TArray<const FXeusAttributeDefinition*> Definitions;
+
+	/**
+	 * @brief Index in Definitions by attribute class
+	 */
+	mutable TMap<UClass*, int32> DefinitionIndices;
+
+	/**
+	 * @brief Collect definitions from array and table (once)
+	 * Pointers are valid until array or table is changed, then definitions are collected again
+	 */
+	void BuildDefinitions() const;
+
+public:
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/**
+	 * @brief Get all definitions of set
+	 * Do not keep returned pointers, they are invalidated when array or table changes
+	 * @return Pointers to immutable definitions
+	 */
+	const TArray<const FXeusAttributeDefinition*>& GetDefinitions() const;
+
+	/**
+	 * @brief Find definition by attribute class
+	 * Do not keep returned pointer, find definition again when it is needed
+	 * @param InClass Attribute class
+	 * @return Pointer to definition if found, nullptr otherwise
+	 */
+	const FXeusAttributeDefinition* FindDefinition(TSubclassOf<UXeusAttribute> InClass) const;
+};
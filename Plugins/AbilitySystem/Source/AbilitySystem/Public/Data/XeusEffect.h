@@ -5,13 +5,18 @@
 #include "CoreMinimal.h"
 #include "UObject/Object.h"
 #include "AbilitySystemTypes.h"
+#include "GameplayTagContainer.h"
+#include "UObject/ObjectKey.h"
 
 #include "XeusEffect.generated.h"
 
+class AActor;
 class UXeusAbilitySystemComponent;
 class UXeusEffect;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FXeusEffectActionDelegate, UXeusEffect*, Effect);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FXeusEffectValueDelegate, UXeusEffect*, Effect, float, Value);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FXeusEffectStackDelegate, UXeusEffect*, Effect, int32, StackCount);
 
 /**
  * Abstract class for all type of gameplay effects
@@ -32,6 +37,8 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable)
 	static UXeusEffect* CreateEffect(TSubclassOf<UXeusEffect> InClass, UObject* Outer);
+
+	virtual void PostInitProperties() override;
 protected:
 	/**
 	 * @brief Saved ability system component pointer
@@ -41,12 +48,27 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Transient)
 	UXeusAbilitySystemComponent* AbilitySystem;
 
+	/**
+	 * @brief Who applied effect
+	 * Set by ability system component when instance is created, stacks do not change it
+	 * @see SetContext
+	 */
+	UPROPERTY(BlueprintReadOnly, Transient)
+	FXeusEffectContext Context;
+
 	/**
 	 * @brief Should be displayed in HUD or not
 	 */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	bool bDisplayable;
 
+	/**
+	 * @brief Localized name for HUD display
+	 * Name of class is used if empty
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	FText DisplayName;
+
 	/**
 	 * @brief Icon for HUD display
 	 */
@@ -58,6 +80,19 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta=(EditCondition="bDisplayable"))
 	FLinearColor EffectColor;
 
+	/**
+	 * @brief Tags granted to owner while effect is active (Debuff.Stun etc..)
+	 * Also used to find and stop effects by tag
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Tags")
+	FGameplayTagContainer GrantedTags;
+
+	/**
+	 * @brief While effect is active, effects that grant any of these tags (or their children) can not be applied
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Tags")
+	FGameplayTagContainer BlockedTags;
+
 	/**
 	 * @brief Should be stackable or not
 	 * If an effect stacks, then when adding identical effects a new one will not be created,
@@ -68,12 +103,124 @@ protected:
 	bool bStackable;
 
 	/**
-	 * @deprecated 
+	 * @brief Instances are reused after removal instead of being destroyed
+	 * Use it for effects that are applied often to many actors (area effects, auras)
+	 * Child classes with own runtime state (blueprint variables too) must override ResetState.
+	 * Instance belongs to another owner after removal, so never keep pointers to it:
+	 * keep FXeusEffectHandle and resolve it through component. Outer of instance is pool, use GetOwnerActor
+	 * @see ResetState
+	 * @see GetHandle
+	 */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly)
+	bool bPoolable;
+
+	/**
+	 * @brief Max count of stacks
+	 */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, meta=(EditCondition="bStackable", ClampMin=1))
+	int32 MaxStacks;
+
+	/**
+	 * @brief What happens with duration when new stack is added
+	 * @see RefreshDuration
+	 * @see ExtendDuration
+	 */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, meta=(EditCondition="bStackable"))
+	EXeusStackDurationPolicy StackDurationPolicy;
+
+	/**
+	 * @brief How stacks are counted by sources
+	 */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, meta=(EditCondition="bStackable"))
+	EXeusStackSourcePolicy StackSourcePolicy;
+
+	/**
+	 * @brief What happens when effect already has max stacks
+	 */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, meta=(EditCondition="bStackable"))
+	EXeusStackOverflowPolicy StackOverflowPolicy;
+
+	/**
+	 * @brief Current stacks from oldest to newest
+	 * All stacks live inside one effect instance
+	 */
+	TArray<FXeusEffectStack, TInlineAllocator<4>> Stacks;
+
+	/**
 	 * @brief All modifiers of effect
+	 * Their product is applied to attributes from ModifierTargets
+	 * @see ModifierTargets
 	 */
-	UPROPERTY(BlueprintReadOnly)
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
 	TArray<FXeusEffectModifier> Modifiers;
 
+	/**
+	 * @brief Attributes affected by total modifier of this effect
+	 * Ability system component keeps them up to date while effect is active
+	 * @see GetTotalModifier
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TArray<FXeusEffectAttributeLink> ModifierTargets;
+
+	/**
+	 * @brief Per-instance parameters this effect was applied with
+	 * Empty if effect was added without settings. Saved in snapshots and rollback history
+	 * next to state of effect, values mapped by Setup are saved as state itself
+	 * @see Setup
+	 */
+	UPROPERTY(BlueprintReadOnly, Transient)
+	FXeusEffectSettings AppliedSettings;
+
+private:
+	/**
+	 * @brief Cached product of all modifiers
+	 * @see GetTotalModifier
+	 */
+	float TotalModifier;
+
+	/**
+	 * @brief Index of modifier in Modifiers array by its unique ID
+	 */
+	TMap<FName, int32> ModifierIndices;
+
+	/**
+	 * @brief Granted tags with all their parents (calculated once)
+	 * @see GetGrantedTagsWithParents
+	 */
+	mutable FGameplayTagContainer GrantedTagsWithParents;
+
+	/**
+	 * @brief Is GrantedTagsWithParents calculated
+	 */
+	mutable bool bGrantedTagsWithParentsCached;
+
+	/**
+	 * @brief Key of instigator (stays same after instigator is destroyed)
+	 * @see SetContext
+	 */
+	FObjectKey InstigatorKey;
+
+	/**
+	 * @brief Handle of effect inside its component
+	 * @see SetHandle
+	 */
+	FXeusEffectHandle EffectHandle;
+
+	/**
+	 * @brief Id of effect inside its component, kept when effect is recreated by rollback
+	 */
+	uint32 RollbackSerial;
+
+	/**
+	 * @brief Rebuild modifier indices and total modifier from Modifiers array
+	 */
+	void RebuildModifierCache();
+
+	/**
+	 * @brief Recalculate product of all modifiers
+	 */
+	void RecalculateTotalModifier();
+
 protected:
 	/**
 	 * @brief Called when effect need to do its work
@@ -89,7 +236,6 @@ protected:
 
 
 	/**
-	 * @deprecated 
 	 * @brief Find modifier by unique ID
 	 * @param UniqueId Id of modifier
 	 * @return Index in Array of Modifiers
@@ -97,25 +243,131 @@ protected:
 	 */
 	UFUNCTION(BlueprintCallable)
 	int32 FindModifier(FName UniqueId) const;
+
+	/**
+	 * @brief Get current time of effect clock of ability system component
+	 * World time is used if effect has not started work yet
+	 * @return Effect time in seconds
+	 */
+	double GetEffectTime() const;
+
+	/**
+	 * @brief Set timer on effect clock of ability system component
+	 * Timers respect pause and time scale of component
+	 * Must be called after effect started work (from Work, RestoreWork or later),
+	 * otherwise timer is not scheduled and error is logged
+	 * @param Callback Function to call
+	 * @param Delay Time until first call
+	 * @param bLoop Should timer repeat
+	 * @param Rate Time between repeated calls (Delay is used if not positive)
+	 * @return Timer handle (invalid if effect has not started work yet)
+	 */
+	FXeusEffectTimerHandle SetEffectTimer(FSimpleDelegate Callback, float Delay, bool bLoop, float Rate = -1.0f) const;
+
+	/**
+	 * @brief Remove timer from effect clock and invalidate handle
+	 * @param Handle Timer handle
+	 */
+	void ClearEffectTimer(FXeusEffectTimerHandle& Handle) const;
+
+	/**
+	 * @brief Called when count of stacks changed
+	 * You can override this to scale magnitude by stacks
+	 * @param OldCount Previous count of stacks
+	 * @param NewCount Current count of stacks
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	void StackCountChanged(int32 OldCount, int32 NewCount);
+
+	/**
+	 * @brief Restart duration of effect
+	 * Called when stack is added with Refresh policy. Does nothing for effects without duration
+	 */
+	virtual void RefreshDuration();
+
+	/**
+	 * @brief Add base duration to remaining duration
+	 * Called when stack is added with Extend policy. Does nothing for effects without duration
+	 */
+	virtual void ExtendDuration();
+
+	/**
+	 * @brief Find index of stack applied by source
+	 * @param Source Stack source
+	 * @return Index in Stacks or INDEX_NONE
+	 */
+	int32 FindStack(const UObject* Source) const;
+
+	/**
+	 * @brief Apply stack duration policy and notify about changed count
+	 * @param OldCount Count of stacks before change
+	 */
+	void HandleStacksChanged(int32 OldCount);
+
+	/**
+	 * @brief Tell component that saved state of effect changed
+	 * Call it when state written by SerializeState changes outside of Work and effect timers
+	 */
+	void MarkStateChanged() const;
+
+	/**
+	 * @brief Continue work after state was restored from snapshot
+	 * Called instead of Work, you should reschedule timers here
+	 * @see SerializeState
+	 */
+	virtual void RestoreWork();
 public:
 	/**
-	 * @deprecated 
-	 * @brief Dynamic initialization of effect
-	 * You should pass pointer to child of FXeusEffectSettings
-	 * @param Settings Pointer to settings struct
+	 * @brief Save or load runtime state of effect (stacks, modifiers, progress etc..)
+	 * Override to add state of child class, do not forget to call Super
+	 * @param Ar Snapshot archive
 	 */
-	virtual void Setup(FXeusEffectSettings* Settings);
+	virtual void SerializeState(FArchive& Ar);
 
 	/**
-	 * @deprecated 
-	 * @brief Multiplies all multipliers into one
+	 * @brief Return runtime state to defaults of class before instance is reused
+	 * Override to reset state of child class and clear its timers, do not forget to call parent
+	 * @see bPoolable
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	void ResetState();
+
+	/**
+	 * @brief Get id of effect inside its component (0 before effect is added)
+	 * @return Rollback serial
+	 */
+	uint32 GetRollbackSerial() const;
+
+	/**
+	 * @brief Set id of effect inside its component
+	 * Called by ability system component
+	 * @param InSerial Rollback serial
+	 */
+	void SetRollbackSerial(uint32 InSerial);
+
+	/**
+	 * @brief Called when effect was restored from snapshot
+	 * Saves AbilitySystem pointer and continues work without calling Work()
+	 * @param InAbilitySystem The component that restored the effect
+	 */
+	void NotifyRestored(UXeusAbilitySystemComponent* InAbilitySystem);
+
+	/**
+	 * @brief Apply per-instance parameters before effect starts work
+	 * Override to map settings to fields of child class, do not forget to call Super
+	 * Base implementation applies modifiers and stores settings in AppliedSettings
+	 * @param Settings Effect settings
+	 */
+	virtual void Setup(const FXeusEffectSettings& Settings);
+
+	/**
+	 * @brief Get product of all modifiers (cached)
 	 * @return Product of multipliers
 	 */
 	UFUNCTION(BlueprintPure)
 	float GetTotalModifier() const;
 
 	/**
-	 * @deprecated 
 	 * @brief Check if modifier with id exists
 	 * @param UniqueId Modifier id 
 	 * @return True if multiplier exists
@@ -124,21 +376,45 @@ public:
 	bool HasModifier(FName UniqueId) const;
 
 	/**
-	 * @deprecated 
-	 * @brief Add new modifier to effect
+	 * @brief Add new modifier to effect or change value of existing one
 	 * @param Mod Modifier settings
 	 */
 	UFUNCTION(BlueprintCallable)
 	void ApplyModifier(FXeusEffectModifier Mod);
 
 	/**
-	 * @deprecated 
 	 * @brief Remove modifier by unique ID
 	 * @param UniqueId Modifier id
 	 */
 	UFUNCTION(BlueprintCallable)
 	void RemoveModifier(FName UniqueId);
 
+	/**
+	 * @brief Get attributes affected by modifiers of this effect
+	 * @return Links to attribute classes
+	 */
+	const TArray<FXeusEffectAttributeLink>& GetModifierTargets() const;
+
+	/**
+	 * @brief Get tags granted to owner while effect is active
+	 * @return Granted tags
+	 */
+	UFUNCTION(BlueprintPure)
+	const FGameplayTagContainer& GetGrantedTags() const;
+
+	/**
+	 * @brief Get granted tags with all their parents (Debuff.Stun -> Debuff.Stun, Debuff)
+	 * @return Granted tags with parents
+	 */
+	const FGameplayTagContainer& GetGrantedTagsWithParents() const;
+
+	/**
+	 * @brief Get tags of effects that can not be applied while effect is active
+	 * @return Blocked tags
+	 */
+	UFUNCTION(BlueprintPure)
+	const FGameplayTagContainer& GetBlockedTags() const;
+
 	/**
 	 * @brief Check if effect is stackable
 	 * @return True if effect is stackable
@@ -147,6 +423,14 @@ public:
 	UFUNCTION(BlueprintPure)
 	bool GetIsStackable() const;
 
+	/**
+	 * @brief Check if instances of effect are reused
+	 * @return True if effect is poolable
+	 * @see bPoolable
+	 */
+	UFUNCTION(BlueprintPure)
+	bool GetIsPoolable() const;
+
 	/**
 	 * @brief Called when we need to stack same effect
 	 * @param InClass Effect class (can be child)
@@ -154,6 +438,83 @@ public:
 	UFUNCTION(BlueprintCallable)
 	virtual void Stack(TSubclassOf<UXeusEffect> InClass);
 
+	/**
+	 * @brief Set first stack of new effect
+	 * Called by ability system component before effect starts work
+	 * @param Source Object that applied effect (can be null)
+	 * @param ApplyTime Effect time of owning component when effect was applied
+	 */
+	void InitStacks(UObject* Source, float ApplyTime);
+
+	/**
+	 * @brief Add new stack according to stack policies
+	 * @param Source Object that applied stack (can be null)
+	 * @return True if stack was added or refreshed, false if rejected
+	 */
+	bool AddStack(UObject* Source);
+
+	/**
+	 * @brief Remove newest stacks. Effect ends work when last stack is removed
+	 * @param Count Count of stacks to remove
+	 * @return Count of removed stacks
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveStacks(int32 Count = 1);
+
+	/**
+	 * @brief Remove all stacks applied by source. Effect ends work when last stack is removed
+	 * @param Source Stack source
+	 * @return Count of removed stacks
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveStacksFromSource(UObject* Source);
+
+	/**
+	 * @brief Remove one stack with same source and apply time. Effect ends work when last stack is removed
+	 * @param Stack Stack to remove
+	 * @return True if stack was found
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool RemoveStack(const FXeusEffectStack& Stack);
+
+	/**
+	 * @brief Get current count of stacks
+	 * @return Stack count
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetStackCount() const;
+
+	/**
+	 * @brief Get max count of stacks
+	 * @return Max stacks (1 for not stackable effects)
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetMaxStacks() const;
+
+	/**
+	 * @brief Get count of stacks applied by source
+	 * @param Source Stack source
+	 * @return Stack count
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetStackCountFromSource(UObject* Source) const;
+
+	/**
+	 * @brief Get data of stack by index (from oldest to newest)
+	 * @param Index Stack index
+	 * @return Copy of stack data
+	 */
+	UFUNCTION(BlueprintPure)
+	FXeusEffectStack GetStack(int32 Index) const;
+
+	/**
+	 * @brief Set source of existing stack
+	 * Used when state is restored, sources are not part of SerializeState
+	 * @param Index Stack index
+	 * @param Source Stack source (can be null)
+	 */
+	void SetStackSource(int32 Index, UObject* Source);
+
 	/**
 	 * @brief Called when effect should start work
 	 * It will prepare all data, save AbilitySystem pointer etc..
@@ -167,6 +528,99 @@ public:
 	 */
 	void NotifyEndWork();
 
+	/**
+	 * @brief Get ability system component of effect
+	 * @return Component pointer (nullptr before effect started work)
+	 */
+	UFUNCTION(BlueprintPure)
+	UXeusAbilitySystemComponent* GetAbilitySystem() const;
+
+	/**
+	 * @brief Get actor that owns component of effect
+	 * Use it instead of outer, pooled effects are outered to pool
+	 * @return Owner of component or outer actor (can be null)
+	 */
+	UFUNCTION(BlueprintPure)
+	AActor* GetOwnerActor() const;
+
+	/**
+	 * @brief Set who applied effect
+	 * Called by ability system component before effect starts work, not changed by later stacks
+	 * @param InContext Instigator and source
+	 */
+	void SetContext(const FXeusEffectContext& InContext);
+
+	/**
+	 * @brief Set context with saved instigator key
+	 * Used when effect is recreated from saved state, key stays valid when instigator is already destroyed
+	 * @param InContext Instigator and source
+	 * @param InInstigatorKey Key of instigator when effect was applied
+	 */
+	void RestoreContext(const FXeusEffectContext& InContext, FObjectKey InInstigatorKey);
+
+	/**
+	 * @brief Set applied settings without applying them
+	 * Used when effect is recreated from saved state, values of settings are already in restored state
+	 * @param InSettings Settings effect was applied with
+	 */
+	void RestoreAppliedSettings(const FXeusEffectSettings& InSettings);
+
+	/**
+	 * @brief Get who applied effect
+	 * @return Instigator and source
+	 */
+	UFUNCTION(BlueprintPure)
+	const FXeusEffectContext& GetContext() const;
+
+	/**
+	 * @brief Get per-instance parameters this effect was applied with
+	 * @return Settings passed to Setup
+	 */
+	UFUNCTION(BlueprintPure)
+	const FXeusEffectSettings& GetAppliedSettings() const;
+
+	/**
+	 * @brief Get actor responsible for effect
+	 * @return Actor pointer (nullptr if unknown or destroyed)
+	 */
+	UFUNCTION(BlueprintPure)
+	AActor* GetInstigator() const;
+
+	/**
+	 * @brief Get object that applied effect
+	 * @return Object pointer (nullptr if unknown or destroyed)
+	 */
+	UFUNCTION(BlueprintPure)
+	UObject* GetEffectSource() const;
+
+	/**
+	 * @brief Get key of instigator for lookups
+	 * @return Object key (empty if there is no instigator)
+	 */
+	FObjectKey GetInstigatorKey() const;
+
+	/**
+	 * @brief Set handle of effect inside its component
+	 * Called by ability system component
+	 * @param InHandle Effect handle
+	 */
+	void SetHandle(const FXeusEffectHandle& InHandle);
+
+	/**
+	 * @brief Get handle of effect, safe to store instead of pointer
+	 * @return Effect handle (invalid before effect is added)
+	 */
+	UFUNCTION(BlueprintPure)
+	FXeusEffectHandle GetHandle() const;
+
+	/**
+	 * @brief Is effect still added to ability system component
+	 * Becomes false as soon as component removes effect, e.g. after EndWork
+	 * @return True if effect is linked to component
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsEffectActive() const;
+
 
 	/**
 	 * @brief Called when some effect added to ability component
@@ -190,6 +644,26 @@ public:
 	UFUNCTION(BlueprintPure)
 	virtual FString GetDebugName() const;
 
+	/**
+	 * @brief Get display name and id of effect class (resolved once per class)
+	 * @return Cached name of class
+	 */
+	const FXeusClassDisplayName& GetClassDisplayName() const;
+
+	/**
+	 * @brief Get localized name for HUD display
+	 * @return DisplayName or name of class
+	 */
+	UFUNCTION(BlueprintPure)
+	FText GetDisplayName() const;
+
+	/**
+	 * @brief Get short id of effect class (class name without blueprint suffix)
+	 * @return Id of class
+	 */
+	UFUNCTION(BlueprintPure)
+	FName GetDisplayId() const;
+
 	/**
 	 * @brief Get icon for HUD display
 	 * @return Soft ptr to icon texture
@@ -218,6 +692,18 @@ public:
 	 * @see EndWork
 	 */
 	FXeusEffectActionDelegate OnNeedRemove;
+
+	/**
+	 * @brief Called when total modifier changed
+	 * @see GetTotalModifier
+	 */
+	FXeusEffectValueDelegate OnTotalModifierChanged;
+
+	/**
+	 * @brief Called when count of stacks changed
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusEffectStackDelegate OnStackCountChanged;
 	
 };
 
@@ -0,0 +1,34 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+
+#include "XeusEffectBundle.generated.h"
+
+class UXeusEffect;
+
+/**
+ * Set of effect classes that some ability set can apply
+ * Can be pre-streamed by ability system component to avoid synchronous loads on apply
+ */
+UCLASS(BlueprintType, ClassGroup=(XeusAbilitySystem))
+class ABILITYSYSTEM_API UXeusEffectBundle : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+public:
+	UXeusEffectBundle();
+
+	/**
+	 * @brief Effect classes of bundle
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TArray<TSoftClassPtr<UXeusEffect>> Effects;
+
+	/**
+	 * @brief Should icons of displayable effects be streamed too
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	bool bPreloadIcons;
+};
@@ -0,0 +1,36 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Templates/SubclassOf.h"
+#include "AbilitySystemTypes.h"
+
+#include "XeusEffectSpec.generated.h"
+
+class UXeusEffect;
+
+/**
+ * Effect class with per-instance settings (Fireball damage, Poison 5s etc..)
+ * One effect class can be shared by many specs instead of subclass per value
+ */
+UCLASS(BlueprintType, ClassGroup=(XeusAbilitySystem))
+class ABILITYSYSTEM_API UXeusEffectSpec : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+public:
+	UXeusEffectSpec();
+
+	/**
+	 * @brief Class of applied effect
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	TSubclassOf<UXeusEffect> EffectClass;
+
+	/**
+	 * @brief Settings applied to every new instance
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly)
+	FXeusEffectSettings Settings;
+};
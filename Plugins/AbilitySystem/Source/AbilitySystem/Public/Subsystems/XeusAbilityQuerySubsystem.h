@@ -0,0 +1,357 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Components/SceneComponent.h"
+#include "Templates/SubclassOf.h"
+#include "AbilitySystemTypes.h"
+
+#include "XeusAbilityQuerySubsystem.generated.h"
+
+class UXeusAbilitySystemComponent;
+class UXeusAttribute;
+class UXeusEffect;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FXeusQueryComponentDelegate, UXeusAbilitySystemComponent*);
+
+/**
+ * Component in sorted view of attribute
+ */
+struct FXeusAttributeRankEntry
+{
+	/**
+	 * @brief Percent of attribute of component
+	 */
+	float Percent;
+
+	/**
+	 * @brief Owner of attribute
+	 */
+	UXeusAbilitySystemComponent* Component;
+
+	bool operator<(const FXeusAttributeRankEntry& Other) const
+	{
+		// Pointer breaks ties, so every entry has exact position
+		return Percent < Other.Percent ||
+			(Percent == Other.Percent && reinterpret_cast<UPTRINT>(Component) < reinterpret_cast<UPTRINT>(Other.Component));
+	}
+};
+
+/**
+ * Components sorted by percent of one attribute class
+ * Changes only update Percents, first query after them moves changed entries in Sorted
+ */
+struct FXeusAttributeRanking
+{
+	/**
+	 * @brief Entries in ascending order of percent (changed components are at old position)
+	 */
+	mutable TArray<FXeusAttributeRankEntry> Sorted;
+
+	/**
+	 * @brief Current percent of component
+	 */
+	TMap<UXeusAbilitySystemComponent*, float> Percents;
+
+	/**
+	 * @brief Components changed since Sorted was updated and their percent in Sorted (unset if not in Sorted)
+	 */
+	mutable TMap<UXeusAbilitySystemComponent*, TOptional<float>> Changed;
+};
+
+/**
+ * Position of component owner in spatial hash
+ */
+struct FXeusSpatialEntry
+{
+	/**
+	 * @brief Location of owner when entry was updated
+	 */
+	FVector Location;
+
+	/**
+	 * @brief Cell of spatial hash
+	 */
+	FIntPoint Cell;
+
+	/**
+	 * @brief Root component of owner
+	 */
+	TWeakObjectPtr<USceneComponent> Root;
+
+	/**
+	 * @brief Binding to TransformUpdated of root component
+	 */
+	FDelegateHandle TransformHandle;
+};
+
+/**
+ * Registries of ability system components of world for AI and targeting
+ * Components by effect class, components sorted by attribute percent and spatial hash of their owners.
+ * Updated by components when effects are added and removed and attribute values change,
+ * spatial hash is updated only for owners that moved
+ */
+UCLASS()
+class ABILITYSYSTEM_API UXeusAbilityQuerySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * @brief Size of cell of spatial hash (XY plane)
+	 */
+	static constexpr float CellSize = 1000.0f;
+
+protected:
+	/**
+	 * @brief Registered components
+	 */
+	TSet<UXeusAbilitySystemComponent*> Components;
+
+	/**
+	 * @brief Count of effects by component by effect class (effects are counted for parent classes too)
+	 */
+	TMap<UClass*, TMap<UXeusAbilitySystemComponent*, int32>> ComponentsByEffect;
+
+	/**
+	 * @brief Sorted views by attribute class
+	 */
+	TMap<UClass*, FXeusAttributeRanking> Rankings;
+
+	/**
+	 * @brief Components in cells of spatial hash
+	 */
+	TMap<FIntPoint, TArray<UXeusAbilitySystemComponent*>> Cells;
+
+	/**
+	 * @brief Position of component in spatial hash
+	 */
+	TMap<UXeusAbilitySystemComponent*, FXeusSpatialEntry> SpatialEntries;
+
+	/**
+	 * @brief Components whose owners moved since last flush
+	 */
+	TSet<UXeusAbilitySystemComponent*> Movers;
+
+	/**
+	 * @brief Add component to spatial hash and track its root component
+	 * @param Component Ability system component
+	 */
+	void AddSpatialEntry(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Remove component from spatial hash
+	 * @param Component Ability system component
+	 */
+	void RemoveSpatialEntry(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Called when root component of owner moved
+	 */
+	void OnRootTransformUpdated(USceneComponent* Root, EUpdateTransformFlags Flags, ETeleportType Teleport,
+	                            UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Set or remove percent of component in ranking and remember it as changed
+	 */
+	static void AddRankEntry(FXeusAttributeRanking& Ranking, UXeusAbilitySystemComponent* Component, float Percent);
+	static void RemoveRankEntry(FXeusAttributeRanking& Ranking, UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Get entries of ranking in ascending order, move changed entries to their place first
+	 * @param Ranking Ranking of attribute class
+	 * @return Sorted entries
+	 */
+	static const TArray<FXeusAttributeRankEntry>& GetSortedEntries(const FXeusAttributeRanking& Ranking);
+
+	/**
+	 * @brief Add all effects and attributes of component to registries
+	 * @param Component Ability system component
+	 */
+	void AddComponentState(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Remove component from all registries
+	 * @param Component Ability system component
+	 */
+	void RemoveComponentState(UXeusAbilitySystemComponent* Component);
+
+public:
+	virtual void Deinitialize() override;
+
+	/**
+	 * @brief Called by component at begin play
+	 * @param Component Ability system component
+	 */
+	void RegisterComponent(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Called by component at end play
+	 * @param Component Ability system component
+	 */
+	void UnregisterComponent(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Called by component when its state was replaced without events (snapshot, rewind)
+	 * @param Component Ability system component
+	 */
+	void RefreshComponent(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Called by component when effect was added
+	 * @param Component Ability system component
+	 * @param Effect Added effect
+	 */
+	void NotifyEffectAdded(UXeusAbilitySystemComponent* Component, const UXeusEffect* Effect);
+
+	/**
+	 * @brief Called by component when effect was removed
+	 * @param Component Ability system component
+	 * @param Effect Removed effect
+	 */
+	void NotifyEffectRemoved(UXeusAbilitySystemComponent* Component, const UXeusEffect* Effect);
+
+	/**
+	 * @brief Called by component when all effects were removed
+	 * @param Component Ability system component
+	 */
+	void NotifyAllEffectsRemoved(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Called by component when attribute was added or its value changed
+	 * @param Component Ability system component
+	 * @param Attribute Attribute
+	 */
+	void NotifyAttributeChanged(UXeusAbilitySystemComponent* Component, const UXeusAttribute* Attribute);
+
+	/**
+	 * @brief Called by component before attribute is removed
+	 * @param Component Ability system component
+	 * @param Attribute Attribute
+	 */
+	void NotifyAttributeRemoved(UXeusAbilitySystemComponent* Component, const UXeusAttribute* Attribute);
+
+	/**
+	 * @brief Called by component when all attributes were removed
+	 * @param Component Ability system component
+	 */
+	void NotifyAllAttributesRemoved(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Check if component has effect of class (or its child)
+	 * @param Component Ability system component
+	 * @param InClass Effect class
+	 * @return True if has
+	 */
+	UFUNCTION(BlueprintPure)
+	bool ComponentHasEffect(UXeusAbilitySystemComponent* Component, TSubclassOf<UXeusEffect> InClass) const;
+
+	/**
+	 * @brief Get components that have effect of class (or its child)
+	 * @param InClass Effect class
+	 * @param OutComponents Found components
+	 * @return Count of components
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 GetComponentsWithEffect(TSubclassOf<UXeusEffect> InClass,
+	                              TArray<UXeusAbilitySystemComponent*>& OutComponents) const;
+
+	/**
+	 * @brief Get components that do not have effect of class (or its child)
+	 * @param InClass Effect class
+	 * @param OutComponents Found components
+	 * @return Count of components
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 GetComponentsWithoutEffect(TSubclassOf<UXeusEffect> InClass,
+	                                 TArray<UXeusAbilitySystemComponent*>& OutComponents) const;
+
+	/**
+	 * @brief Get count of components that have effect of class (or its child)
+	 * @param InClass Effect class
+	 * @return Count of components
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetEffectComponentCount(TSubclassOf<UXeusEffect> InClass) const;
+
+	/**
+	 * @brief Get components with lowest (or highest) percent of attribute
+	 * @param InClass Attribute class
+	 * @param Count Max count of components
+	 * @param bHighest Start from highest percent
+	 * @param OutComponents Found components in order
+	 * @return Count of components
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 GetComponentsByAttributePercent(TSubclassOf<UXeusAttribute> InClass, int32 Count, bool bHighest,
+	                                      TArray<UXeusAbilitySystemComponent*>& OutComponents) const;
+
+	/**
+	 * @brief Visit components in order of attribute percent until visitor returns false
+	 * @param InClass Attribute class
+	 * @param bHighest Start from highest percent
+	 * @param Visitor Called with component and percent, return false to stop
+	 */
+	void ForEachByAttributePercent(TSubclassOf<UXeusAttribute> InClass, bool bHighest,
+	                               TFunctionRef<bool(UXeusAbilitySystemComponent*, float)> Visitor) const;
+
+	/**
+	 * @brief Get components with attribute percent in range
+	 * @param InClass Attribute class
+	 * @param MinPercent Min percent (inclusive)
+	 * @param MaxPercent Max percent (inclusive)
+	 * @param OutComponents Found components in ascending order
+	 * @return Count of components
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 GetComponentsInAttributePercentRange(TSubclassOf<UXeusAttribute> InClass, float MinPercent,
+	                                           float MaxPercent,
+	                                           TArray<UXeusAbilitySystemComponent*>& OutComponents) const;
+
+	/**
+	 * @brief Get cell of spatial hash that contains location
+	 * @param Location World location
+	 * @return Cell coordinates
+	 */
+	static FIntPoint GetCell(const FVector& Location);
+
+	/**
+	 * @brief Move components whose owners moved to their new cells
+	 * Called before every spatial query, OnComponentMoved is broadcast for each of them
+	 */
+	void FlushMovers();
+
+	/**
+	 * @brief Get components whose owners are inside area
+	 * @param Shape Area in world space
+	 * @param OutComponents Found components
+	 * @return Count of components
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 GetComponentsInShape(const FXeusAreaShape& Shape, TArray<UXeusAbilitySystemComponent*>& OutComponents);
+
+	/**
+	 * @brief Get location of component owner stored in spatial hash
+	 * @param Component Ability system component
+	 * @param OutLocation Location of owner
+	 * @return True if component is in spatial hash
+	 */
+	bool GetComponentLocation(UXeusAbilitySystemComponent* Component, FVector& OutLocation) const;
+
+	/**
+	 * @brief Called when position of component in spatial hash was updated
+	 */
+	FXeusQueryComponentDelegate OnComponentMoved;
+
+	/**
+	 * @brief Called after component was added to registries
+	 */
+	FXeusQueryComponentDelegate OnComponentRegistered;
+
+	/**
+	 * @brief Called before component is removed from registries
+	 */
+	FXeusQueryComponentDelegate OnComponentUnregistered;
+};
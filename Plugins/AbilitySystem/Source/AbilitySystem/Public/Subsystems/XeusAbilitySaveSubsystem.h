@@ -0,0 +1,228 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AbilitySystemTypes.h"
+
+#include "XeusAbilitySaveSubsystem.generated.h"
+
+class UXeusAbilitySystemComponent;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FXeusAbilitySaveDelegate, const FString&, FileName, bool, bSuccess);
+
+/**
+ * Snapshot shared between game thread and background save
+ * Never modified after capture, changed state is captured to a new snapshot
+ */
+typedef TSharedPtr<FXeusAbilitySystemSnapshot, ESPMode::ThreadSafe> FXeusSharedAbilitySnapshot;
+
+/**
+ * Snapshot of one component inside save file
+ */
+struct FXeusAbilitySaveRecord
+{
+	/**
+	 * @brief Stable id of component
+	 * @see UXeusAbilitySystemComponent::GetSaveId
+	 */
+	FName SaveId;
+
+	/**
+	 * @brief State of component
+	 */
+	FXeusSharedAbilitySnapshot Snapshot;
+};
+
+/**
+ * Last captured snapshot of registered component
+ */
+struct FXeusAbilitySnapshotCache
+{
+	/**
+	 * @brief Component the snapshot was captured from
+	 */
+	TWeakObjectPtr<UXeusAbilitySystemComponent> Component;
+
+	/**
+	 * @brief State revision of component at capture
+	 * @see UXeusAbilitySystemComponent::GetStateRevision
+	 */
+	uint32 Revision = 0;
+
+	/**
+	 * @brief Captured state
+	 */
+	FXeusSharedAbilitySnapshot Snapshot;
+};
+
+/**
+ * Saves and loads state of all ability system components of world
+ * Game thread only captures snapshots of components changed since previous capture (copy-on-write),
+ * unchanged components share their last snapshot. File is written and read on background thread.
+ * Loaded snapshots are restored when components with the same save id begin play
+ */
+UCLASS()
+class ABILITYSYSTEM_API UXeusAbilitySaveSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * @brief Written at the beginning of save file
+	 */
+	static constexpr uint32 FileMagic = 0x46534158; // XASF
+
+	/**
+	 * @brief Increment when layout of save file changes
+	 */
+	static constexpr int32 FileVersion = 1;
+
+	/**
+	 * @brief Size of buffer that is flushed to disk at once
+	 */
+	static constexpr int32 ChunkSize = 1024 * 1024;
+
+protected:
+	/**
+	 * @brief Components that began play
+	 */
+	TMap<FName, TWeakObjectPtr<UXeusAbilitySystemComponent>> Components;
+
+	/**
+	 * @brief Loaded snapshots of components that have not begun play yet
+	 */
+	TMap<FName, FXeusSharedAbilitySnapshot> PendingSnapshots;
+
+	/**
+	 * @brief Last snapshots of registered components by save id
+	 */
+	TMap<FName, FXeusAbilitySnapshotCache> SnapshotCache;
+
+	/**
+	 * @brief Is file being written
+	 */
+	bool bSaving;
+
+	/**
+	 * @brief Is file being read
+	 */
+	bool bLoading;
+
+	/**
+	 * @brief Restore pending snapshot of component if there is one
+	 * @param Component Ability system component
+	 * @return True if restored
+	 */
+	bool RestorePending(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Called on game thread when background save finished
+	 */
+	void SaveFinished(FString FileName, bool bSuccess);
+
+	/**
+	 * @brief Called on game thread when background load finished
+	 */
+	void LoadFinished(FString FileName, TSharedRef<TArray<FXeusAbilitySaveRecord>, ESPMode::ThreadSafe> Records,
+	                  bool bSuccess);
+
+public:
+	UXeusAbilitySaveSubsystem();
+
+	virtual void Deinitialize() override;
+
+	/**
+	 * @brief Called by component at begin play. Restores loaded snapshot of component
+	 * @param Component Ability system component
+	 */
+	void RegisterComponent(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Called by component at end play
+	 * @param Component Ability system component
+	 */
+	void UnregisterComponent(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Find registered component by save id
+	 * @param SaveId Save id of component
+	 * @return Component or nullptr
+	 */
+	UXeusAbilitySystemComponent* FindComponent(FName SaveId) const;
+
+	/**
+	 * @brief Capture snapshots of all registered components
+	 * Only components whose state revision changed are serialized, others reuse last snapshot
+	 * @param OutRecords Snapshots with save ids
+	 * @return Count of components that were serialized
+	 */
+	int32 CaptureAll(TArray<FXeusAbilitySaveRecord>& OutRecords);
+
+	/**
+	 * @brief Capture all components and write them to file on background thread
+	 * @param FileName Save file (relative to Saved directory)
+	 * @return True if save started
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool SaveToFile(const FString& FileName);
+
+	/**
+	 * @brief Read file on background thread and restore components lazily
+	 * Registered components are restored when file is read, others when they begin play
+	 * @param FileName Save file (relative to Saved directory)
+	 * @return True if load started
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool LoadFromFile(const FString& FileName);
+
+	/**
+	 * @brief Check if file is being written or read
+	 * @return True if busy
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsBusy() const;
+
+	/**
+	 * @brief Get count of loaded snapshots that wait for their components
+	 * @return Count of snapshots
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetPendingCount() const;
+
+	/**
+	 * @brief Write records to file in chunks. Can be called from any thread
+	 * @param FilePath Absolute file path
+	 * @param Records Snapshots with save ids
+	 * @return True if written
+	 */
+	static bool WriteRecords(const FString& FilePath, const TArray<FXeusAbilitySaveRecord>& Records);
+
+	/**
+	 * @brief Read records from file. Can be called from any thread
+	 * @param FilePath Absolute file path
+	 * @param OutRecords Snapshots with save ids
+	 * @return True if read
+	 */
+	static bool ReadRecords(const FString& FilePath, TArray<FXeusAbilitySaveRecord>& OutRecords);
+
+	/**
+	 * @brief Get absolute path of save file
+	 * @param FileName Save file (relative to Saved directory)
+	 * @return Absolute path
+	 */
+	static FString GetSaveFilePath(const FString& FileName);
+
+	/**
+	 * @brief Called when background save finished
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusAbilitySaveDelegate OnSaveFinished;
+
+	/**
+	 * @brief Called when background load finished
+	 */
+	UPROPERTY(BlueprintAssignable)
+	FXeusAbilitySaveDelegate OnLoadFinished;
+};
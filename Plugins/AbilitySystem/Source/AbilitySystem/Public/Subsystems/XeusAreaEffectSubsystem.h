@@ -0,0 +1,129 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Templates/SubclassOf.h"
+#include "AbilitySystemTypes.h"
+
+#include "XeusAreaEffectSubsystem.generated.h"
+
+class UXeusAbilitySystemComponent;
+class UXeusEffect;
+
+/**
+ * Result of applying effect to area
+ */
+USTRUCT(BlueprintType)
+struct FXeusAreaEffectReport
+{
+	GENERATED_BODY()
+public:
+	/**
+	 * @brief Count of components inside area
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Targets = 0;
+
+	/**
+	 * @brief Count of components that received effect (new or stacked)
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Applied = 0;
+
+	/**
+	 * @brief Count of components that rejected effect (immunity, blocked tags, filters)
+	 */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Resisted = 0;
+};
+
+/**
+ * Free instances of one effect class
+ */
+USTRUCT()
+struct FXeusEffectPool
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	TArray<UXeusEffect*> Effects;
+};
+
+/**
+ * Applies effects to all ability system components inside area in one pass
+ * Targets are collected from spatial hash of UXeusAbilityQuerySubsystem.
+ * Also keeps pools of instances of poolable effects
+ * @see UXeusEffect::bPoolable
+ */
+UCLASS()
+class ABILITYSYSTEM_API UXeusAreaEffectSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * @brief Max count of free instances kept for one effect class
+	 */
+	static constexpr int32 MaxPooledPerClass = 256;
+
+protected:
+	/**
+	 * @brief Free instances by effect class
+	 */
+	UPROPERTY(Transient)
+	TMap<UClass*, FXeusEffectPool> Pools;
+
+	/**
+	 * @brief Targets of current application (memory is reused)
+	 */
+	TArray<UXeusAbilitySystemComponent*> TargetsScratch;
+
+public:
+	virtual void Deinitialize() override;
+
+	/**
+	 * @brief Apply effect to all components inside area
+	 * @param Shape Area in world space
+	 * @param InClass Effect class
+	 * @param Source Source of effect stacks (can be null)
+	 * @return Counts of targets, applied and resisted
+	 */
+	UFUNCTION(BlueprintCallable)
+	FXeusAreaEffectReport ApplyEffectInArea(const FXeusAreaShape& Shape, TSubclassOf<UXeusEffect> InClass,
+	                                        UObject* Source);
+
+	/**
+	 * @brief Apply effect to components in one pass
+	 * @param Targets Ability system components
+	 * @param InClass Effect class
+	 * @param Source Source of effect stacks (can be null)
+	 * @return Counts of targets, applied and resisted
+	 */
+	FXeusAreaEffectReport ApplyEffectToTargets(TArrayView<UXeusAbilitySystemComponent* const> Targets,
+	                                           TSubclassOf<UXeusEffect> InClass, UObject* Source);
+
+	/**
+	 * @brief Take free instance of poolable effect or create new one
+	 * @param InClass Effect class
+	 * @return Effect instance with default state
+	 */
+	UXeusEffect* AcquireEffect(TSubclassOf<UXeusEffect> InClass);
+
+	/**
+	 * @brief Reset state of removed effect and keep it for reuse
+	 * Effect is destroyed if pool of its class is full
+	 * Pointers to effect kept by game code are not valid after this call, only handles are
+	 * @param InEffect Removed effect
+	 */
+	void ReleaseEffect(UXeusEffect* InEffect);
+
+	/**
+	 * @brief Get count of free instances of effect class
+	 * @param InClass Effect class
+	 * @return Count of instances
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetPooledCount(TSubclassOf<UXeusEffect> InClass) const;
+};
@@ -0,0 +1,262 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Templates/SubclassOf.h"
+#include "AbilitySystemTypes.h"
+
+#include "XeusAuraSubsystem.generated.h"
+
+class UXeusAbilitySystemComponent;
+class UXeusEffect;
+class USceneComponent;
+
+/**
+ * Effect applied by aura to component inside it
+ */
+struct FXeusAuraMember
+{
+	/**
+	 * @brief Applied effect (null if component resisted it)
+	 */
+	TWeakObjectPtr<UXeusEffect> Effect;
+
+	/**
+	 * @brief Rollback serial of applied effect, pooled instance can be reused by another effect
+	 */
+	uint32 Serial = 0;
+
+	/**
+	 * @brief Is stack of stackable effect added by aura
+	 */
+	bool bHasStack = false;
+
+	/**
+	 * @brief Stack added by aura, only this stack is removed when component leaves
+	 */
+	FXeusEffectStack Stack;
+};
+
+/**
+ * Area that keeps effect on components inside it
+ */
+struct FXeusAura
+{
+	/**
+	 * @brief Area, center is offset from attached component if there is one
+	 */
+	FXeusAreaShape Shape;
+
+	/**
+	 * @brief Effect applied to components inside
+	 */
+	TSubclassOf<UXeusEffect> EffectClass;
+
+	/**
+	 * @brief Source of effect stacks
+	 */
+	TWeakObjectPtr<UObject> Source;
+
+	/**
+	 * @brief Component aura follows (can be null)
+	 */
+	TWeakObjectPtr<USceneComponent> Attach;
+
+	/**
+	 * @brief Binding to TransformUpdated of attached component
+	 */
+	FDelegateHandle TransformHandle;
+
+	/**
+	 * @brief Area in world space
+	 */
+	FXeusAreaShape WorldShape;
+
+	/**
+	 * @brief Cells of spatial hash covered by area
+	 */
+	TArray<FIntPoint> Cells;
+
+	/**
+	 * @brief Components inside aura
+	 */
+	TMap<UXeusAbilitySystemComponent*, FXeusAuraMember> Members;
+};
+
+/**
+ * Keeps effects of persistent auras (paladin aura, poison cloud etc..) on components inside them
+ * Effect is applied when component enters aura and removed when it leaves.
+ * Only components and auras that moved are checked every frame
+ */
+UCLASS()
+class ABILITYSYSTEM_API UXeusAuraSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+protected:
+	/**
+	 * @brief Auras by id
+	 */
+	TMap<int32, FXeusAura> Auras;
+
+	/**
+	 * @brief Auras that cover cell of spatial hash
+	 */
+	TMap<FIntPoint, TArray<int32>> AuraCells;
+
+	/**
+	 * @brief Auras component is inside
+	 */
+	TMap<UXeusAbilitySystemComponent*, TArray<int32>> Memberships;
+
+	/**
+	 * @brief Components that moved or were registered since last update
+	 */
+	TSet<UXeusAbilitySystemComponent*> DirtyComponents;
+
+	/**
+	 * @brief Auras that moved or changed shape since last update
+	 */
+	TSet<int32> DirtyAuras;
+
+	/**
+	 * @brief Auras that follow component, they are removed when component is destroyed
+	 */
+	TSet<int32> AttachedAuras;
+
+	/**
+	 * @brief Id of last added aura
+	 */
+	int32 LastAuraId;
+
+	/**
+	 * @brief Candidate auras of component (memory is reused)
+	 */
+	TArray<int32> CandidatesScratch;
+
+	/**
+	 * @brief Components inside area of aura (memory is reused)
+	 */
+	TArray<UXeusAbilitySystemComponent*> TargetsScratch;
+
+	/**
+	 * @brief Bindings to query subsystem
+	 */
+	FDelegateHandle MovedHandle;
+	FDelegateHandle RegisteredHandle;
+	FDelegateHandle UnregisteredHandle;
+
+	/**
+	 * @brief Called by query subsystem
+	 */
+	void Component_Moved(UXeusAbilitySystemComponent* Component);
+	void Component_Unregistered(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Called when attached component of aura moved
+	 */
+	void OnAttachTransformUpdated(USceneComponent* Root, EUpdateTransformFlags Flags, ETeleportType Teleport,
+	                              int32 AuraId);
+
+	/**
+	 * @brief Recalculate world area of aura and cells it covers
+	 * @return False if aura lost its attached component
+	 */
+	bool UpdateAuraCells(int32 AuraId, FXeusAura& Aura);
+
+	/**
+	 * @brief Remove auras whose attached components were destroyed
+	 */
+	void RemoveDetachedAuras();
+
+	/**
+	 * @brief Remove aura from cells it covers
+	 */
+	void RemoveAuraCells(int32 AuraId, FXeusAura& Aura);
+
+	/**
+	 * @brief Apply effect of aura to component that entered it
+	 */
+	void Enter(int32 AuraId, UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Remove effect of aura from component that left it
+	 */
+	void Leave(int32 AuraId, FXeusAura& Aura, UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Check auras near moved component and auras it is inside
+	 */
+	void UpdateComponent(UXeusAbilitySystemComponent* Component);
+
+	/**
+	 * @brief Compare components inside moved aura with its members
+	 */
+	void UpdateAura(int32 AuraId);
+
+public:
+	UXeusAuraSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+
+	/**
+	 * @brief Add aura that keeps effect on components inside area
+	 * @param Shape Area (center is offset from AttachTo if it is set)
+	 * @param EffectClass Effect applied to components inside
+	 * @param Source Source of effect stacks (can be null)
+	 * @param AttachTo Component aura follows (can be null), aura is removed when it is destroyed
+	 * @return Id of aura
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 AddAura(const FXeusAreaShape& Shape, TSubclassOf<UXeusEffect> EffectClass, UObject* Source,
+	              USceneComponent* AttachTo);
+
+	/**
+	 * @brief Remove aura and its effect from all components inside it
+	 * @param AuraId Id of aura
+	 * @return True if removed
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool RemoveAura(int32 AuraId);
+
+	/**
+	 * @brief Change area of aura (membership is updated next frame)
+	 * @param AuraId Id of aura
+	 * @param Shape New area
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetAuraShape(int32 AuraId, const FXeusAreaShape& Shape);
+
+	/**
+	 * @brief Update membership of moved components and auras now
+	 * Called every frame
+	 */
+	UFUNCTION(BlueprintCallable)
+	void UpdateAuras();
+
+	/**
+	 * @brief Check if component is inside aura
+	 * @param AuraId Id of aura
+	 * @param Component Ability system component
+	 * @return True if inside
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsInAura(int32 AuraId, UXeusAbilitySystemComponent* Component) const;
+
+	/**
+	 * @brief Get count of components inside aura
+	 * @param AuraId Id of aura
+	 * @return Count of components
+	 */
+	UFUNCTION(BlueprintPure)
+	int32 GetAuraMemberCount(int32 AuraId) const;
+};
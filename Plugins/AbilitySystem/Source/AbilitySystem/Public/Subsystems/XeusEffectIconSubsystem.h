@@ -0,0 +1,123 @@
+﻿// Developed by OIC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "XeusEffectIconSubsystem.generated.h"
+
+class UTexture2D;
+struct FStreamableHandle;
+
+/**
+ * Streaming state of one effect icon
+ */
+struct FXeusEffectIconStreaming
+{
+	/**
+	 * @brief Handle that keeps icon loaded
+	 */
+	TSharedPtr<FStreamableHandle> Handle;
+
+	/**
+	 * @brief Count of live effects that use icon (in all components)
+	 */
+	int32 RefCount = 0;
+
+	/**
+	 * @brief Memory of loaded icon texture (0 while loading)
+	 */
+	int64 Bytes = 0;
+};
+
+/**
+ * Ref-counted LRU cache of icons of displayable effects, shared by all ability system components of world
+ * Icons are keyed by path, so the icon that was requested is the icon that is measured and released
+ * @see UXeusAbilitySystemComponent::bPrefetchIcons
+ */
+UCLASS(Config=Game)
+class ABILITYSYSTEM_API UXeusEffectIconSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+	/**
+	 * @brief Memory of loaded icons (in MB) after which icons no effect uses are released
+	 * Icons of live effects are never released
+	 */
+	UPROPERTY(Config)
+	float CacheBudgetMB;
+
+	/**
+	 * @brief Streaming icons by path
+	 */
+	TMap<FSoftObjectPath, FXeusEffectIconStreaming> Icons;
+
+	/**
+	 * @brief Icons that are loaded but not used by any effect (oldest first)
+	 */
+	TArray<FSoftObjectPath> UnusedIcons;
+
+	/**
+	 * @brief Memory of all loaded icons
+	 */
+	int64 CacheBytes;
+
+	/**
+	 * @brief Called when icon is loaded to count its memory
+	 * @param Path Icon path
+	 */
+	void OnIconLoaded(FSoftObjectPath Path);
+
+	/**
+	 * @brief Release least recently used icons until cache fits budget
+	 */
+	void TrimCache();
+
+public:
+	UXeusEffectIconSubsystem();
+
+	virtual void Deinitialize() override;
+
+	/**
+	 * @brief Request icon and add reference to it
+	 * @param Path Icon path
+	 */
+	void AcquireIcon(const FSoftObjectPath& Path);
+
+	/**
+	 * @brief Remove reference to icon, unused icon stays cached until budget is exceeded
+	 * @param Path Icon path that was acquired
+	 */
+	void ReleaseIcon(const FSoftObjectPath& Path);
+
+	/**
+	 * @brief Check if icon is prefetched and loaded
+	 * @param Icon Icon texture
+	 * @return True if icon is in memory
+	 */
+	UFUNCTION(BlueprintPure)
+	bool IsIconLoaded(const TSoftObjectPtr<UTexture2D>& Icon) const;
+
+	/**
+	 * @brief Get memory of prefetched icons
+	 * @return Memory in MB
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetCacheSizeMB() const;
+
+	/**
+	 * @brief Get memory budget of unused icons
+	 * @return Budget in MB
+	 */
+	UFUNCTION(BlueprintPure)
+	float GetCacheBudgetMB() const;
+
+	/**
+	 * @brief Change memory budget of unused icons
+	 * @param InBudgetMB Budget in MB
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetCacheBudgetMB(float InBudgetMB);
+};